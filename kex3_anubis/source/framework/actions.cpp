@@ -711,11 +711,12 @@ void kexInputAction::AddAction(byte id, const char *name)
 // kexInputAction::WriteBindings
 //
 
-void kexInputAction::WriteBindings(FILE *file)
+void kexInputAction::WriteBindings(kexBinFile &file)
 {
     cmdLink_t *keycmd;
     cmdlist_t *cmd;
     char *tmp;
+    kexStr line;
 
     for(int i = 0; i < MAX_KEYS; i++)
     {
@@ -728,8 +729,9 @@ void kexInputAction::WriteBindings(FILE *file)
 
         for(cmd = keycmd->Next(); cmd; cmd = cmd->link.Next())
         {
-            fprintf(file, "bind %s \"%s\"\n", tmp,
+            line = kexStr::Format("bind %s \"%s\"\n", tmp,
                 (cmd->action == NULL) ? cmd->command : cmd->action->name.c_str());
+            file.WriteBytes((const byte*)line.c_str(), line.Length());
         }
     }
 }
@@ -36,6 +36,8 @@ typedef struct cmdlist_s
     cmdLink_t           link;
 } cmdlist_t;
 
+class kexBinFile;
+
 class kexInputAction
 {
 public:
@@ -43,7 +45,7 @@ public:
     int                     FindAction(const char *name);
     void                    AddAction(byte id, const char *name);
     bool                    ActionExists(const char *name);
-    void                    WriteBindings(FILE *file);
+    void                    WriteBindings(kexBinFile &file);
     void                    ExecuteCommand(int key, bool up, const int eventType);
     void                    ExecuteMouseCommand(int button, bool up);
     int                     GetKeyCode(char *key);
@@ -16,6 +16,7 @@
 #define __KEXARRAY_H__
 
 #include <assert.h>
+#include <utility>
 
 template<class type>
 class kexArray
@@ -34,6 +35,7 @@ public:
     void                Empty(void);
     void                Init(void);
     void                Resize(unsigned int size);
+    void                Reserve(unsigned int size);
     type                IndexOf(unsigned int index) const;
     bool                Contains(const type check) const;
     void                Splice(const unsigned int start, unsigned int len);
@@ -41,6 +43,7 @@ public:
     void                Sort(compare_t *function, unsigned int count);
 
     const unsigned int  Length(void) const { return length; }
+    const unsigned int  Capacity(void) const { return capacity; }
     type                GetData(const int index) { return data[index]; }
 
     type                &operator[](unsigned int index);
@@ -50,6 +53,7 @@ public:
 protected:
     type                *data;
     unsigned int        length;
+    unsigned int        capacity;
     unsigned int        aidx;
 };
 
@@ -79,18 +83,47 @@ void kexArray<type>::Init(void)
 {
     data = NULL;
     length = 0;
+    capacity = 0;
     aidx = 0;
 }
 
 //
-// kexArray::Resize
+// kexArray::Reserve
+//
+// Makes room for at least size elements without
+// changing the length of the array
 //
 template<class type>
-void kexArray<type>::Resize(unsigned int size)
+void kexArray<type>::Reserve(unsigned int size)
 {
     type *tmp;
-    unsigned int cnt;
 
+    if(size <= capacity)
+    {
+        return;
+    }
+
+    tmp = data;
+    data = new type[size];
+
+    for(unsigned int i = 0; i < length; i++)
+    {
+        data[i] = std::move(tmp[i]);
+    }
+
+    capacity = size;
+    delete[] tmp;
+}
+
+//
+// kexArray::Resize
+//
+// Growing past the capacity at least doubles it, so
+// repeatedly growing by one element is amortized
+//
+template<class type>
+void kexArray<type>::Resize(unsigned int size)
+{
     if(size == length)
     {
         return;
@@ -101,35 +134,25 @@ void kexArray<type>::Resize(unsigned int size)
         delete[] data;
         data = NULL;
         length = 0;
+        capacity = 0;
         return;
     }
 
-    if(length == 0)
+    if(size > capacity)
     {
-        data = new type[size];
-        length = size;
-        return;
-    }
-
-    tmp = data;
-    data = new type[size];
-
-    if(length <= size)
-    {
-        cnt = length;
+        Reserve(MAX(size, capacity * 2));
     }
     else
     {
-        cnt = size;
-    }
-
-    for(unsigned int i = 0; i < cnt; i++)
-    {
-        data[i] = tmp[i];
+        // reset the dropped elements so growing the array
+        // again hands back fresh ones
+        for(unsigned int i = size; i < length; i++)
+        {
+            data[i] = type();
+        }
     }
 
     length = size;
-    delete[] tmp;
 }
 
 //
@@ -139,7 +162,7 @@ template<class type>
 void kexArray<type>::Push(type o)
 {
     Resize(length+1);
-    data[aidx++] = o;
+    data[aidx++] = std::move(o);
 }
 
 //
@@ -193,11 +216,12 @@ type kexArray<type>::GetLast(void)
 template<class type>
 void kexArray<type>::Empty(void)
 {
-    if(data && length > 0)
+    if(data)
     {
         delete[] data;
         data = NULL;
         length = 0;
+        capacity = 0;
         aidx = 0;
     }
 }
@@ -258,6 +282,7 @@ void kexArray<type>::Splice(const unsigned int start, unsigned int len)
 
     delete[] data;
     data = tmp;
+    capacity = len;
     length = length - len;
     aidx = length-1;
 }
@@ -335,6 +360,7 @@ kexArray<type> &kexArray<type>::operator=(const kexArray<type> &arr)
 
     data = NULL;
     length = arr.length;
+    capacity = arr.length;
     aidx = arr.aidx;
 
     if(arr.length > 0)
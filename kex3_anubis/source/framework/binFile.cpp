@@ -16,6 +16,16 @@
 
 #include "kexlib.h"
 
+#ifdef KEX_WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 //
 // kexBinFile::kexBinFile
 //
@@ -26,6 +36,14 @@ kexBinFile::kexBinFile(void)
     this->buffer = NULL;
     this->bufferLength = 0;
     this->bufferOffset = 0;
+    this->bOpened = false;
+    this->bView = false;
+    this->bOverrun = false;
+    this->bMapped = false;
+    this->mapHandle = NULL;
+    this->writeBuffer = NULL;
+    this->writeLength = 0;
+    this->bWriteError = false;
 }
 
 //
@@ -40,14 +58,18 @@ kexBinFile::~kexBinFile(void)
 //
 // kexBinFile::Open
 //
+// The buffer is a read-only view into the pak file
+//
 
-bool kexBinFile::Open(const char *file, kexHeapBlock &heapBlock)
+bool kexBinFile::Open(const char *file)
 {
-    int buffsize = kex::cPakFiles->OpenFile(file, (byte**)(&buffer), heapBlock);
+    int buffsize = kex::cPakFiles->OpenFileView(file, (byte**)(&buffer));
 
     if(buffsize > 0)
     {
         bOpened = true;
+        bView = true;
+        bOverrun = false;
         handle = NULL;
         bufferOffset = 0;
         bufferLength = buffsize;
@@ -68,6 +90,8 @@ bool kexBinFile::OpenExternal(const char *file)
     if(len > 0)
     {
         bOpened = true;
+        bView = false;
+        bOverrun = false;
         handle = NULL;
         bufferOffset = 0;
         bufferLength = len;
@@ -93,22 +117,181 @@ bool kexBinFile::OpenStream(const char *file)
     return false;
 }
 
+//
+// kexBinFile::OpenMapped
+//
+// Maps a file outside of the pak files copy-on-write, so the
+// buffer can be modified in place without touching the file
+//
+
+bool kexBinFile::OpenMapped(const char *file)
+{
+#ifdef KEX_WIN32
+    HANDLE fileHandle;
+    HANDLE mapping;
+    DWORD size;
+
+    fileHandle = CreateFileA(file, GENERIC_READ, FILE_SHARE_READ, NULL,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if(fileHandle == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    size = GetFileSize(fileHandle, NULL);
+    mapping = CreateFileMappingA(fileHandle, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(fileHandle);
+
+    if(size == INVALID_FILE_SIZE || size == 0 || mapping == NULL)
+    {
+        if(mapping != NULL)
+        {
+            CloseHandle(mapping);
+        }
+        return false;
+    }
+
+    if(!(buffer = (byte*)MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0)))
+    {
+        CloseHandle(mapping);
+        return false;
+    }
+
+    mapHandle = (void*)mapping;
+    bufferLength = (unsigned int)size;
+#else
+    struct stat st;
+    void *data;
+    int fd;
+
+    if((fd = open(file, O_RDONLY)) == -1)
+    {
+        return false;
+    }
+
+    if(fstat(fd, &st) != 0 || st.st_size <= 0 || (uint64_t)st.st_size > 0x7fffffff)
+    {
+        close(fd);
+        return false;
+    }
+
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ|PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(data == MAP_FAILED)
+    {
+        return false;
+    }
+
+    buffer = (byte*)data;
+    bufferLength = (unsigned int)st.st_size;
+#endif
+
+    bOpened = true;
+    bView = false;
+    bMapped = true;
+    bOverrun = false;
+    handle = NULL;
+    bufferOffset = 0;
+    return true;
+}
+
 //
 // kexBinFile::Create
 //
+// Output is buffered and goes to a temporary file, which only
+// replaces the real one once the file is closed
+//
 
 bool kexBinFile::Create(const char *file)
 {
-    if((handle = fopen(file, "wb")))
+    filePath = file;
+
+    if((handle = fopen((filePath + ".tmp").c_str(), "wb")))
     {
         bOpened = true;
         bufferOffset = 0;
+        writeBuffer = (byte*)Mem_Malloc(WriteBufferSize, hb_static);
+        writeLength = 0;
+        bWriteError = false;
         return true;
     }
 
     return false;
 }
 
+//
+// kexBinFile::Flush
+//
+
+void kexBinFile::Flush(void)
+{
+    if(writeLength == 0)
+    {
+        return;
+    }
+
+    if(fwrite(writeBuffer, 1, writeLength, handle) != writeLength)
+    {
+        bWriteError = true;
+    }
+
+    writeLength = 0;
+}
+
+//
+// kexBinFile::Commit
+//
+// Writes out whatever is left and moves the temporary file over the
+// real one. If anything went wrong the original file is left alone
+//
+
+bool kexBinFile::Commit(void)
+{
+    kexStr tempPath = filePath + ".tmp";
+
+    Flush();
+
+    if(fflush(handle) != 0)
+    {
+        bWriteError = true;
+    }
+
+#ifndef KEX_WIN32
+    if(!bWriteError && fsync(fileno(handle)) != 0)
+    {
+        bWriteError = true;
+    }
+#endif
+
+    fclose(handle);
+    handle = NULL;
+
+    Mem_Free(writeBuffer);
+    writeBuffer = NULL;
+
+    if(bWriteError)
+    {
+        remove(tempPath.c_str());
+        kex::cSystem->Warning("kexBinFile::Close: Failed to write %s\n", filePath.c_str());
+        return false;
+    }
+
+#ifdef KEX_WIN32
+    if(!MoveFileExA(tempPath.c_str(), filePath.c_str(), MOVEFILE_REPLACE_EXISTING|MOVEFILE_WRITE_THROUGH))
+#else
+    if(rename(tempPath.c_str(), filePath.c_str()) != 0)
+#endif
+    {
+        remove(tempPath.c_str());
+        kex::cSystem->Warning("kexBinFile::Close: Failed to replace %s\n", filePath.c_str());
+        return false;
+    }
+
+    return true;
+}
+
 //
 // kexBinFile::Close
 //
@@ -119,18 +302,44 @@ void kexBinFile::Close(void)
     {
         return;
     }
+    if(writeBuffer)
+    {
+        Commit();
+    }
     if(handle)
     {
     #ifndef __linux__
         fclose(handle);
     #endif
+        handle = NULL;
     }
     if(buffer)
     {
-        Mem_Free(buffer);
+        if(bView)
+        {
+            kex::cPakFiles->CloseFileView(buffer);
+        }
+        else if(bMapped)
+        {
+#ifdef KEX_WIN32
+            UnmapViewOfFile(buffer);
+            CloseHandle((HANDLE)mapHandle);
+#else
+            munmap(buffer, bufferLength);
+#endif
+            mapHandle = NULL;
+        }
+        else
+        {
+            Mem_Free(buffer);
+        }
+
+        buffer = NULL;
     }
 
     bOpened = false;
+    bView = false;
+    bMapped = false;
 }
 
 //
@@ -181,6 +390,11 @@ int kexBinFile::Length(void)
         return bufferLength;
     }
 
+    if(writeBuffer)
+    {
+        return bufferOffset;
+    }
+
     // save the current position in the file
     savedpos = ftell(handle);
 
@@ -215,9 +429,14 @@ uint kexBinFile::ReadStream(uint offset, byte *buffer, uint length)
 
 byte kexBinFile::Read8(void)
 {
-    byte result;
-    result = buffer[bufferOffset++];
-    return result;
+    const byte *data;
+
+    if(!(data = ReadBlock(1)))
+    {
+        return 0;
+    }
+
+    return data[0];
 }
 
 //
@@ -226,10 +445,14 @@ byte kexBinFile::Read8(void)
 
 short kexBinFile::Read16(void)
 {
-    int result;
-    result = Read8();
-    result |= Read8() << 8;
-    return result;
+    const byte *data;
+
+    if(!(data = ReadBlock(2)))
+    {
+        return 0;
+    }
+
+    return Get16(data);
 }
 
 //
@@ -238,12 +461,14 @@ short kexBinFile::Read16(void)
 
 int kexBinFile::Read32(void)
 {
-    int result;
-    result = Read8();
-    result |= Read8() << 8;
-    result |= Read8() << 16;
-    result |= Read8() << 24;
-    return result;
+    const byte *data;
+
+    if(!(data = ReadBlock(4)))
+    {
+        return 0;
+    }
+
+    return Get32(data);
 }
 
 //
@@ -252,9 +477,97 @@ int kexBinFile::Read32(void)
 
 float kexBinFile::ReadFloat(void)
 {
-    fint_t fi;
-    fi.i = Read32();
-    return fi.f;
+    const byte *data;
+
+    if(!(data = ReadBlock(4)))
+    {
+        return 0;
+    }
+
+    return GetFloat(data);
+}
+
+//
+// kexBinFile::ReadBlock
+//
+// Returns count records of the given size at the current position and
+// moves past them. Reading past the end returns NULL and flags the file
+// as overrun, after which every read fails
+//
+
+const byte *kexBinFile::ReadBlock(const unsigned int size, const unsigned int count)
+{
+    const byte *data;
+
+    if(bOverrun || buffer == NULL || bufferOffset > bufferLength ||
+        (size != 0 && count > (bufferLength - bufferOffset) / size))
+    {
+        bOverrun = true;
+        return NULL;
+    }
+
+    data = &buffer[bufferOffset];
+    bufferOffset += size * count;
+
+    return data;
+}
+
+//
+// kexBinFile::SwapBlock
+//
+// Converts a block of little endian values to the host's byte order.
+// Nothing to do on little endian hosts; otherwise the loops are kept
+// simple enough for the compiler to vectorize
+//
+
+void kexBinFile::SwapBlock(void *data, const unsigned int size, const unsigned int count)
+{
+    const uint16_t order = 1;
+
+    if(size <= 1 || *(const byte*)&order == 1)
+    {
+        return;
+    }
+
+    switch(size)
+    {
+    case 2:
+        {
+            uint16_t *p = (uint16_t*)data;
+
+            for(unsigned int i = 0; i < count; ++i)
+            {
+                p[i] = (p[i] >> 8) | (p[i] << 8);
+            }
+        }
+        break;
+
+    case 4:
+        {
+            uint32_t *p = (uint32_t*)data;
+
+            for(unsigned int i = 0; i < count; ++i)
+            {
+                p[i] = (p[i] >> 24) | ((p[i] >> 8) & 0xff00) |
+                       ((p[i] << 8) & 0xff0000) | (p[i] << 24);
+            }
+        }
+        break;
+
+    default:
+        for(unsigned int i = 0; i < count; ++i)
+        {
+            byte *p = (byte*)data + i * size;
+
+            for(unsigned int j = 0; j < size / 2; ++j)
+            {
+                byte tmp = p[j];
+                p[j] = p[size-1-j];
+                p[size-1-j] = tmp;
+            }
+        }
+        break;
+    }
 }
 
 //
@@ -362,18 +675,55 @@ kexMatrix kexBinFile::ReadMatrix(void)
 
 void kexBinFile::Write8(const byte val)
 {
-    fwrite(&val, 1, 1, handle);
+    if(writeLength >= WriteBufferSize)
+    {
+        Flush();
+    }
+
+    writeBuffer[writeLength++] = val;
     bufferOffset++;
 }
 
+//
+// kexBinFile::WriteBytes
+//
+
+void kexBinFile::WriteBytes(const byte *data, const unsigned int length)
+{
+    if(writeLength + length > WriteBufferSize)
+    {
+        Flush();
+
+        // too big to be worth buffering
+        if(length >= WriteBufferSize)
+        {
+            if(fwrite(data, 1, length, handle) != length)
+            {
+                bWriteError = true;
+            }
+
+            bufferOffset += length;
+            return;
+        }
+    }
+
+    memcpy(writeBuffer + writeLength, data, length);
+    writeLength += length;
+    bufferOffset += length;
+}
+
 //
 // kexBinFile::Write16
 //
 
 void kexBinFile::Write16(const short val)
 {
-    Write8(val & 0xff);
-    Write8((val >> 8) & 0xff);
+    byte data[2];
+
+    data[0] = val & 0xff;
+    data[1] = (val >> 8) & 0xff;
+
+    WriteBytes(data, 2);
 }
 
 //
@@ -382,10 +732,14 @@ void kexBinFile::Write16(const short val)
 
 void kexBinFile::Write32(const int val)
 {
-    Write8(val & 0xff);
-    Write8((val >> 8) & 0xff);
-    Write8((val >> 16) & 0xff);
-    Write8((val >> 24) & 0xff);
+    byte data[4];
+
+    data[0] = val & 0xff;
+    data[1] = (val >> 8) & 0xff;
+    data[2] = (val >> 16) & 0xff;
+    data[3] = (val >> 24) & 0xff;
+
+    WriteBytes(data, 4);
 }
 
 //
@@ -450,14 +804,7 @@ void kexBinFile::WriteQuaternion(const kexQuat &quat)
 
 void kexBinFile::WriteString(const kexStr &val)
 {
-    const char *c = val.c_str();
-
-    for(int i = 0; i < val.Length(); i++)
-    {
-        Write8(c[i]);
-    }
-
-    Write8(0);
+    WriteBytes((const byte*)val.c_str(), val.Length() + 1);
 }
 
 //
@@ -27,9 +27,10 @@ public:
     kexBinFile(void);
     ~kexBinFile(void);
 
-    bool                Open(const char *file, kexHeapBlock &heapBlock = hb_static);
+    bool                Open(const char *file);
     bool                OpenExternal(const char *file);
     bool                OpenStream(const char *file);
+    bool                OpenMapped(const char *file);
     bool                Create(const char *file);
     void                Close(void);
     int                 Length(void);
@@ -38,6 +39,9 @@ public:
 
     uint                ReadStream(uint offset, byte *buffer, uint length);
 
+    const byte          *ReadBlock(const unsigned int size, const unsigned int count = 1);
+    template<typename type>
+    bool                ReadArray(type *dest, const unsigned int count);
     byte                Read8(void);
     short               Read16(void);
     int                 Read32(void);
@@ -49,6 +53,9 @@ public:
     kexMatrix           ReadMatrix(void);
     kexStr              ReadString(void);
 
+    void                WriteBytes(const byte *data, const unsigned int length);
+    template<typename type>
+    void                WriteArray(const type *data, const unsigned int count);
     void                Write8(const byte val);
     void                Write16(const short val);
     void                Write32(const int val);
@@ -66,13 +73,83 @@ public:
     const bool          IsOpened(void) const { return bOpened; }
     const unsigned int  BufferOffset(void) const { return bufferOffset; }
     void                SetPosition(const int pos) { bufferOffset = pos; }
+    const bool          Overrun(void) const { return bOverrun; }
+
+    static short        Get16(const byte *data) { return data[0] | (data[1] << 8); }
+    static int          Get32(const byte *data) { return data[0] | (data[1] << 8) | (data[2] << 16) | (data[3] << 24); }
+    static float        GetFloat(const byte *data) { fint_t fi; fi.i = Get32(data); return fi.f; }
+    static void         SwapBlock(void *data, const unsigned int size, const unsigned int count);
 
 private:
+    void                Flush(void);
+    bool                Commit(void);
+
+    static const unsigned int WriteBufferSize = 0x10000;
+
     FILE                *handle;
     byte                *buffer;
     unsigned int        bufferOffset;
     unsigned int        bufferLength;
     bool                bOpened;
+    bool                bView;
+    bool                bOverrun;
+    bool                bMapped;
+    void                *mapHandle;
+
+    byte                *writeBuffer;
+    unsigned int        writeLength;
+    bool                bWriteError;
+    kexStr              filePath;
 };
 
+//
+// kexBinFile::ReadArray
+//
+// Reads count little endian elements into dest. On overrun
+// dest is zeroed and nothing is consumed
+//
+template<typename type>
+bool kexBinFile::ReadArray(type *dest, const unsigned int count)
+{
+    const byte *src;
+
+    if(!(src = ReadBlock(sizeof(type), count)))
+    {
+        memset(dest, 0, sizeof(type) * count);
+        return false;
+    }
+
+    memcpy(dest, src, sizeof(type) * count);
+    SwapBlock(dest, sizeof(type), count);
+
+    return true;
+}
+
+//
+// kexBinFile::WriteArray
+//
+// Elements are always written out little endian
+//
+template<typename type>
+void kexBinFile::WriteArray(const type *data, const unsigned int count)
+{
+    const uint16_t order = 1;
+
+    if(sizeof(type) == 1 || *(const byte*)&order == 1)
+    {
+        WriteBytes((const byte*)data, sizeof(type) * count);
+        return;
+    }
+
+    for(unsigned int i = 0; i < count; i++)
+    {
+        const byte *src = (const byte*)&data[i];
+
+        for(int j = sizeof(type)-1; j >= 0; j--)
+        {
+            Write8(src[j]);
+        }
+    }
+}
+
 #endif
@@ -241,9 +241,10 @@ void kexCvarManager::Register(kexCvar *variable)
 // kexCvarManager::WriteToFile
 //
 
-void kexCvarManager::WriteToFile(FILE *file)
+void kexCvarManager::WriteToFile(kexBinFile &file)
 {
     kexCvar *cvar;
+    kexStr line;
 
     for(cvar = first; cvar; cvar = cvar->GetNext())
     {
@@ -252,7 +253,8 @@ void kexCvarManager::WriteToFile(FILE *file)
             continue;
         }
 
-        fprintf(file, "seta %s \"%s\"\n", cvar->GetName(), cvar->GetValue());
+        line = kexStr::Format("seta %s \"%s\"\n", cvar->GetName(), cvar->GetValue());
+        file.WriteBytes((const byte*)line.c_str(), line.Length());
     }
 }
 
@@ -30,6 +30,8 @@ typedef enum
     CVF_ALLOCATED   = BIT(7)
 } cvarFlags_t;
 
+class kexBinFile;
+
 class kexCvar
 {
 public:
@@ -81,7 +83,7 @@ public:
     void            Set(const char *var_name, float value);
     void            Set(const char *var_name, int value);
     void            AutoComplete(const char *partial);
-    void            WriteToFile(FILE *file);
+    void            WriteToFile(kexBinFile &file);
     kexCvar         *GetFirst(void) const { return first; }
     void            Shutdown(void);
 
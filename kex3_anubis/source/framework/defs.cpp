@@ -61,6 +61,8 @@ void kexDefManager::ParseBlock(kexDict *defEntry, kexLexer *lexer)
 
         defEntry->Add(key.c_str(), val.c_str());
     }
+
+    defEntry->Compile();
 }
 
 //
@@ -103,6 +105,9 @@ void kexDefManager::Parse(kexLexer *lexer)
 void kexDefManager::LoadFilesInDirectory(const char *directory)
 {
     kexStrList list;
+    kexStrList files;
+    kexArray<byte*> buffers;
+    kexArray<int> lengths;
 
     kex::cPakFiles->GetMatchingFiles(list, directory);
 
@@ -114,7 +119,14 @@ void kexDefManager::LoadFilesInDirectory(const char *directory)
             continue;
         }
 
-        LoadFile(list[i].c_str());
+        files.Push(list[i]);
+    }
+
+    kex::cPakFiles->OpenFiles(files, buffers, lengths, hb_static);
+
+    for(unsigned int i = 0; i < files.Length(); ++i)
+    {
+        LoadFile(files[i].c_str(), (char*)buffers[i], lengths[i]);
     }
 }
 
@@ -137,6 +149,23 @@ void kexDefManager::LoadFile(const char *defFile)
     kex::cParser->Close();
 }
 
+//
+// kexDefManager::LoadFile
+//
+
+void kexDefManager::LoadFile(const char *defFile, char *buffer, const int size)
+{
+    kexLexer *lexer;
+    
+    if(!(lexer = kex::cParser->Open(defFile, buffer, size)))
+    {
+        return;
+    }
+    
+    Parse(lexer);
+    kex::cParser->Close();
+}
+
 //
 // kexDefManager::GetEntry
 //
@@ -214,6 +243,9 @@ void kexIndexDefManager::Parse(kexLexer *lexer)
                     defEntry->Add(key.c_str(), val.c_str());
                     hashKey->data.Add(key.c_str(), val.c_str());
                 }
+
+                defEntry->Compile();
+                hashKey->data.Compile();
                 break;
             default:
                 break;
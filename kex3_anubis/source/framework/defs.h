@@ -22,6 +22,7 @@ public:
 
     void                            LoadFilesInDirectory(const char *directory);
     void                            LoadFile(const char *defFile);
+    void                            LoadFile(const char *defFile, char *buffer, const int size);
     kexDict                         *GetEntry(const char *name);
 
     kexHashList<kexDict>            defs;
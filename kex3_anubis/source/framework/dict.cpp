@@ -25,6 +25,7 @@ kexHashKey::kexHashKey(const char *key, const char *value)
 {
     this->key = key;
     this->value = value;
+    this->bCompiled = false;
 }
 
 //
@@ -35,6 +36,7 @@ kexHashKey::kexHashKey(void)
 {
     this->key = "";
     this->value = "";
+    this->bCompiled = false;
 }
 
 //
@@ -49,10 +51,75 @@ kexHashKey::~kexHashKey(void)
 // kexHashKey::operator=
 //
 
-void kexHashKey::operator=(kexHashKey &hashKey)
+void kexHashKey::operator=(const kexHashKey &hashKey)
 {
     this->key = hashKey.key;
     this->value = hashKey.value;
+    this->bCompiled = hashKey.bCompiled;
+    this->floatValue = hashKey.floatValue;
+    this->intValue = hashKey.intValue;
+    this->vecValue[0] = hashKey.vecValue[0];
+    this->vecValue[1] = hashKey.vecValue[1];
+    this->vecValue[2] = hashKey.vecValue[2];
+    this->atomValue = hashKey.atomValue;
+}
+
+//
+// kexHashKey::Compile
+//
+// Parses the value into every type it can be read back as
+//
+
+void kexHashKey::Compile(void)
+{
+    floatValue = (float)atof(value.c_str());
+    intValue = atoi(value.c_str());
+    vecValue[0] = vecValue[1] = vecValue[2] = 0;
+    sscanf(value.c_str(), "%f %f %f", &vecValue[0], &vecValue[1], &vecValue[2]);
+    atomValue = value;
+    bCompiled = true;
+}
+
+//
+// kexHashKey::GetFloat
+//
+
+const float kexHashKey::GetFloat(void)
+{
+    return bCompiled ? floatValue : (float)atof(value.c_str());
+}
+
+//
+// kexHashKey::GetInt
+//
+
+const int kexHashKey::GetInt(void)
+{
+    return bCompiled ? intValue : atoi(value.c_str());
+}
+
+//
+// kexHashKey::GetVector
+//
+
+void kexHashKey::GetVector(kexVec3 &out)
+{
+    if(bCompiled)
+    {
+        out.Set(vecValue[0], vecValue[1], vecValue[2]);
+        return;
+    }
+
+    sscanf(value.c_str(), "%f %f %f", &out.x, &out.y, &out.z);
+}
+
+//
+// kexHashKey::GetAtom
+//
+
+const kexAtom kexHashKey::GetAtom(void)
+{
+    return bCompiled ? atomValue : kexAtom(value);
 }
 
 //
@@ -110,6 +177,21 @@ void kexDict::Empty(void)
     }
 }
 
+//
+// kexDict::Compile
+//
+
+void kexDict::Compile(void)
+{
+    for(int i = 0; i < hashSize; i++)
+    {
+        for(unsigned int j = 0; j < hashlist[i].Length(); j++)
+        {
+            hashlist[i][j].Compile();
+        }
+    }
+}
+
 //
 // kexDict::Resize
 //
@@ -193,7 +275,7 @@ bool kexDict::GetFloat(const char *key, float &out, const float defaultValue)
         return false;
     }
 
-    out = (float)atof(k->GetString());
+    out = k->GetFloat();
     return true;
 }
 
@@ -221,7 +303,7 @@ bool kexDict::GetInt(const char *key, int &out, const int defaultValue)
         return false;
     }
 
-    out = atoi(k->GetString());
+    out = k->GetInt();
     return true;
 }
 
@@ -249,7 +331,7 @@ bool kexDict::GetInt(const char *key, uint8_t &out, const int defaultValue)
         return false;
     }
 
-    out = (uint8_t)atoi(k->GetString());
+    out = (uint8_t)k->GetInt();
     return true;
 }
 
@@ -268,7 +350,7 @@ bool kexDict::GetInt(const char *key, int16_t &out, const int defaultValue)
         return false;
     }
 
-    out = (int16_t)atoi(k->GetString());
+    out = (int16_t)k->GetInt();
     return true;
 }
 
@@ -296,7 +378,7 @@ bool kexDict::GetBool(const char *key, bool &out, const bool defaultValue)
         return false;
     }
 
-    out = (atoi(k->GetString()) != 0);
+    out = (k->GetInt() != 0);
     return true;
 }
 
@@ -322,7 +404,7 @@ bool kexDict::GetBool(const char *key)
         return false;
     }
 
-    return (atoi(k->GetString()) != 0);
+    return (k->GetInt() != 0);
 }
 
 //
@@ -351,6 +433,23 @@ bool kexDict::GetString(const kexStr &key, kexStr &out)
     return GetString(key.c_str(), out);
 }
 
+//
+// kexDict::GetString
+//
+
+bool kexDict::GetString(const char *key, kexAtom &out)
+{
+    kexHashKey *k;
+
+    if(!(k = Find(key)))
+    {
+        return false;
+    }
+
+    out = k->GetAtom();
+    return true;
+}
+
 //
 // kexDict::GetVector
 //
@@ -366,7 +465,7 @@ bool kexDict::GetVector(const char *key, kexVec3 &out)
         return false;
     }
 
-    sscanf(k->GetString(), "%f %f %f", &out.x, &out.y, &out.z);
+    k->GetVector(out);
     return true;
 }
 
@@ -17,6 +17,8 @@
 
 #include "mathlib.h"
 
+class kexVec3;
+
 class kexHashKey
 {
 public:
@@ -24,17 +26,28 @@ public:
     kexHashKey(void);
     ~kexHashKey(void);
 
-    void                        operator=(kexHashKey &hashKey);
+    void                        operator=(const kexHashKey &hashKey);
+
+    void                        Compile(void);
 
     const char                  *GetName(void) { return key.c_str(); }
     const char                  *GetString(void) { return value.c_str(); }
+    const float                 GetFloat(void);
+    const int                   GetInt(void);
+    void                        GetVector(kexVec3 &out);
+    const kexAtom               GetAtom(void);
 
 private:
     kexStr                      key;
     kexStr                      value;
-};
 
-class kexVec3;
+    // values parsed once by Compile so spawning doesn't go through atof/sscanf
+    bool                        bCompiled;
+    float                       floatValue;
+    int                         intValue;
+    float                       vecValue[3];
+    kexAtom                     atomValue;
+};
 
 class kexDict
 {
@@ -46,6 +59,7 @@ public:
     kexHashKey                  *Find(const char *name);
     void                        Empty(void);
     void                        Resize(int newSize);
+    void                        Compile(void);
 
     const int                   GetHashSize(void) const { return hashSize; }
     kexArray<kexHashKey>        *GetHashList(void) { return hashlist; }
@@ -63,6 +77,7 @@ public:
     bool                        GetBool(const char *key);
     bool                        GetString(const char *key, kexStr &out);
     bool                        GetString(const kexStr &key, kexStr &out);
+    bool                        GetString(const char *key, kexAtom &out);
     bool                        GetVector(const char *key, kexVec3 &out);
     bool                        GetVector(const kexStr &key, kexVec3 &out);
 
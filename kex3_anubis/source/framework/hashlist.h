@@ -15,34 +15,68 @@
 #ifndef __HASHLIST_H__
 #define __HASHLIST_H__
 
+//
+// Open addressing hash table. Each slot caches the full 32-bit hash
+// of its key so that most probes never touch the key string. Entries
+// added with an index are kept in a separate table keyed on the index.
+// Entries are also kept in insertion order for iteration.
+//
 template<class type>
 class kexHashList
 {
 public:
     kexHashList(void);
+    ~kexHashList(void);
 
     type                *Add(const char *tname, kexHeapBlock &hb = hb_static);
     type                *Add(const char *tname, const int index, kexHeapBlock &hb = hb_static);
     type                *Find(const char *tname) const;
     type                *Find(const int index) const;
     type                *GetData(const int index);
-    type                *Next(void);
     char                *GetName(const int index);
 
+    const int           Length(void) const { return keys.Length(); }
+
     typedef struct hashKey_s
     {
         type            data;
-        filepath_t      name;
+        char            *name;
         int             refIndex;
-        hashKey_s       *next;
     } hashKey_t;
 
+    typedef struct
+    {
+        unsigned int    hash;
+        hashKey_t       *key;
+    } hashSlot_t;
+
     hashKey_t           *GetHashKey(const char *tname);
     hashKey_t           *GetHashKey(const unsigned int index);
     hashKey_t           *AddAndReturnHashKey(const char *tname, kexHeapBlock &hb = hb_static);
 
-    hashKey_t           *hashlist[MAX_HASH];
-    hashKey_t           *rover;
+    static unsigned int HashName(const char *tname);
+    static unsigned int HashIndex(const int index);
+
+private:
+    typedef struct
+    {
+        hashSlot_t      *slots;
+        unsigned int    mask;
+        unsigned int    count;
+    } hashTable_t;
+
+    hashKey_t           *NewKey(const char *tname, const int index, kexHeapBlock &hb);
+    void                Insert(hashTable_t &table, const unsigned int hash, hashKey_t *key);
+    void                Rehash(hashTable_t &table, const unsigned int size);
+
+    hashKey_t           *LookupName(const char *tname) const;
+    hashKey_t           *LookupIndex(const int index) const;
+
+    static const unsigned int   InitialSize = 64;
+
+    hashTable_t         nameTable;
+    hashTable_t         indexTable;
+    kexArray<hashKey_t*> keys;
 };
 
 //
@@ -51,144 +85,204 @@ public:
 template<class type>
 kexHashList<type>::kexHashList(void)
 {
-    memset(hashlist, 0, sizeof(hashKey_t*) * MAX_HASH);
+    memset(&nameTable, 0, sizeof(hashTable_t));
+    memset(&indexTable, 0, sizeof(hashTable_t));
 }
 
 //
-// kexHashList::Add
+// kexHashList::~kexHashList
 //
 template<class type>
-type *kexHashList<type>::Add(const char *tname, kexHeapBlock &hb)
+kexHashList<type>::~kexHashList(void)
 {
-    unsigned int hash;
+    delete[] nameTable.slots;
+    delete[] indexTable.slots;
+}
 
-    hashKey_t *o = (hashKey_t*)Mem_Calloc(sizeof(hashKey_t), hb);
-    strncpy(o->name, tname, MAX_FILEPATH);
-    o->refIndex = -1;
+//
+// kexHashList::HashName
+//
+template<class type>
+unsigned int kexHashList<type>::HashName(const char *tname)
+{
+    unsigned int hash = 0;
+    char c;
 
-    // add to hash for future reference
-    hash = kexStr::Hash(o->name);
-    o->next = hashlist[hash];
-    hashlist[hash] = o;
+    while((c = *tname++))
+    {
+        hash = c + (hash << 6) + (hash << 16) - hash;
+    }
 
-    return &o->data;
+    return hash;
 }
 
 //
-// kexHashList::Add
+// kexHashList::HashIndex
 //
 template<class type>
-type *kexHashList<type>::Add(const char *tname, const int index, kexHeapBlock &hb)
+unsigned int kexHashList<type>::HashIndex(const int index)
 {
-    unsigned int hash;
-    
-    hashKey_t *o = (hashKey_t*)Mem_Calloc(sizeof(hashKey_t), hb);
-    strncpy(o->name, tname, MAX_FILEPATH);
-    o->refIndex = index;
-    
-    // add to hash for future reference
-    hash = index & (MAX_HASH-1);
-    o->next = hashlist[hash];
-    hashlist[hash] = o;
-
-    return &o->data;
+    return (unsigned int)index * 2654435761U;
 }
 
 //
-// kexHashList::AddAndReturnHashKey
+// kexHashList::NewKey
+//
+// The key and its name are allocated together
 //
 template<class type>
 typename kexHashList<type>::hashKey_t *
-kexHashList<type>::AddAndReturnHashKey(const char *tname, kexHeapBlock &hb)
+kexHashList<type>::NewKey(const char *tname, const int index, kexHeapBlock &hb)
 {
-    unsigned int hash;
+    int len = strlen(tname);
+    hashKey_t *o;
 
-    hashKey_t *o = (hashKey_t*)Mem_Calloc(sizeof(hashKey_t), hb);
-    strncpy(o->name, tname, MAX_FILEPATH);
-    o->refIndex = -1;
+    if(len >= MAX_FILEPATH)
+    {
+        len = MAX_FILEPATH-1;
+    }
 
-    // add to hash for future reference
-    hash = kexStr::Hash(o->name);
-    o->next = hashlist[hash];
-    hashlist[hash] = o;
+    o = (hashKey_t*)Mem_Calloc(sizeof(hashKey_t) + len + 1, hb);
+    o->name = (char*)(o + 1);
+    o->refIndex = index;
+    memcpy(o->name, tname, len);
 
+    keys.Push(o);
     return o;
 }
 
 //
-// kexHashList::Find
+// kexHashList::Rehash
 //
 template<class type>
-type *kexHashList<type>::Find(const char *tname) const
+void kexHashList<type>::Rehash(hashTable_t &table, const unsigned int size)
 {
-    hashKey_t *t;
-    unsigned int hash;
+    hashSlot_t *oldSlots = table.slots;
+    unsigned int oldSize = oldSlots ? table.mask + 1 : 0;
+
+    table.slots = new hashSlot_t[size];
+    table.mask = size - 1;
+    table.count = 0;
 
-    hash = kexStr::Hash(tname);
+    memset(table.slots, 0, sizeof(hashSlot_t) * size);
 
-    for(t = hashlist[hash]; t; t = t->next)
+    for(unsigned int i = 0; i < oldSize; ++i)
     {
-        if(!strcmp(tname, t->name))
+        if(oldSlots[i].key)
         {
-            return &t->data;
+            Insert(table, oldSlots[i].hash, oldSlots[i].key);
         }
     }
 
-    return NULL;
+    delete[] oldSlots;
 }
 
 //
-// kexHashList::GetHashKey
+// kexHashList::Insert
+//
+// A key that matches an existing entry replaces it, so
+// later definitions override earlier ones
 //
 template<class type>
-typename kexHashList<type>::hashKey_t *kexHashList<type>::GetHashKey(const char *tname)
+void kexHashList<type>::Insert(hashTable_t &table, const unsigned int hash, hashKey_t *key)
 {
-    hashKey_t *t;
-    unsigned int hash;
+    hashSlot_t *slot;
+    unsigned int i;
 
-    hash = kexStr::Hash(tname);
+    // keep the load factor under 3/4
+    if(table.slots == NULL || (table.count + 1) * 4 > (table.mask + 1) * 3)
+    {
+        Rehash(table, table.slots ? (table.mask + 1) * 2 : InitialSize);
+    }
 
-    for(t = hashlist[hash]; t; t = t->next)
+    for(i = hash & table.mask;; i = (i + 1) & table.mask)
     {
-        if(!strcmp(tname, t->name))
+        slot = &table.slots[i];
+
+        if(slot->key == NULL)
+        {
+            table.count++;
+            break;
+        }
+
+        if(slot->hash != hash)
+        {
+            continue;
+        }
+
+        if(&table == &indexTable ? slot->key->refIndex == key->refIndex :
+                                   !strcmp(slot->key->name, key->name))
         {
-            return t;
+            break;
         }
     }
 
-    return NULL;
+    slot->hash = hash;
+    slot->key = key;
 }
 
 //
-// kexHashList::GetHashKey
+// kexHashList::LookupName
 //
 template<class type>
-typename kexHashList<type>::hashKey_t *kexHashList<type>::GetHashKey(const unsigned int index)
+typename kexHashList<type>::hashKey_t *kexHashList<type>::LookupName(const char *tname) const
 {
-    return hashlist[index];
+    unsigned int hash;
+    hashSlot_t *slot;
+
+    if(nameTable.slots == NULL)
+    {
+        return NULL;
+    }
+
+    hash = HashName(tname);
+
+    for(unsigned int i = hash & nameTable.mask;; i = (i + 1) & nameTable.mask)
+    {
+        slot = &nameTable.slots[i];
+
+        if(slot->key == NULL)
+        {
+            return NULL;
+        }
+
+        if(slot->hash == hash && !strcmp(tname, slot->key->name))
+        {
+            return slot->key;
+        }
+    }
+
+    return NULL;
 }
 
 //
-// kexHashList::Find
+// kexHashList::LookupIndex
 //
 template<class type>
-type *kexHashList<type>::Find(const int index) const
+typename kexHashList<type>::hashKey_t *kexHashList<type>::LookupIndex(const int index) const
 {
     unsigned int hash;
-    hashKey_t *t;
-    
-    hash = index & (MAX_HASH-1);
+    hashSlot_t *slot;
 
-    for(t = hashlist[hash]; t; t = t->next)
+    if(indexTable.slots == NULL)
     {
-        if(t->refIndex == -1)
+        return NULL;
+    }
+
+    hash = HashIndex(index);
+
+    for(unsigned int i = hash & indexTable.mask;; i = (i + 1) & indexTable.mask)
+    {
+        slot = &indexTable.slots[i];
+
+        if(slot->key == NULL)
         {
-            continue;
+            return NULL;
         }
 
-        if(t->refIndex == index)
+        if(slot->hash == hash && slot->key->refIndex == index)
         {
-            return &t->data;
+            return slot->key;
         }
     }
 
@@ -196,28 +290,94 @@ type *kexHashList<type>::Find(const int index) const
 }
 
 //
-// kexHashList::GetData
+// kexHashList::Add
 //
 template<class type>
-type *kexHashList<type>::GetData(const int index)
+type *kexHashList<type>::Add(const char *tname, kexHeapBlock &hb)
+{
+    return &AddAndReturnHashKey(tname, hb)->data;
+}
+
+//
+// kexHashList::Add
+//
+template<class type>
+type *kexHashList<type>::Add(const char *tname, const int index, kexHeapBlock &hb)
+{
+    hashKey_t *o = NewKey(tname, index, hb);
+
+    Insert(indexTable, HashIndex(index), o);
+    return &o->data;
+}
+
+//
+// kexHashList::AddAndReturnHashKey
+//
+template<class type>
+typename kexHashList<type>::hashKey_t *
+kexHashList<type>::AddAndReturnHashKey(const char *tname, kexHeapBlock &hb)
 {
-    rover = hashlist[index];
-    return &rover->data;
+    hashKey_t *o = NewKey(tname, -1, hb);
+
+    Insert(nameTable, HashName(o->name), o);
+    return o;
 }
 
 //
-// kexHashList::Next
+// kexHashList::Find
 //
 template<class type>
-type *kexHashList<type>::Next(void)
+type *kexHashList<type>::Find(const char *tname) const
 {
-    if(rover->next)
+    hashKey_t *t = LookupName(tname);
+    return t ? &t->data : NULL;
+}
+
+//
+// kexHashList::GetHashKey
+//
+template<class type>
+typename kexHashList<type>::hashKey_t *kexHashList<type>::GetHashKey(const char *tname)
+{
+    return LookupName(tname);
+}
+
+//
+// kexHashList::GetHashKey
+//
+// Returns keys in the order they were added
+//
+template<class type>
+typename kexHashList<type>::hashKey_t *kexHashList<type>::GetHashKey(const unsigned int index)
+{
+    if(index >= keys.Length())
     {
-        rover = rover->next;
-        return &rover->data;
+        return NULL;
     }
 
-    return NULL;
+    return keys[index];
+}
+
+//
+// kexHashList::Find
+//
+template<class type>
+type *kexHashList<type>::Find(const int index) const
+{
+    hashKey_t *t = LookupIndex(index);
+    return t ? &t->data : NULL;
+}
+
+//
+// kexHashList::GetData
+//
+// Returns entries in the order they were added
+//
+template<class type>
+type *kexHashList<type>::GetData(const int index)
+{
+    hashKey_t *t = GetHashKey((unsigned int)index);
+    return t ? &t->data : NULL;
 }
 
 //
@@ -226,7 +386,8 @@ type *kexHashList<type>::Next(void)
 template<class type>
 char *kexHashList<type>::GetName(const int index)
 {
-    return rover->name;
+    hashKey_t *t = GetHashKey((unsigned int)index);
+    return t ? t->name : NULL;
 }
 
 #endif
@@ -21,229 +21,1530 @@
 #include "kpf.h"
 #include "unzip.h"
 
-#ifndef KEX_WIN32
+#ifdef KEX_WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+static kexPakFile pakFileLocal;
+static kexHeapBlock hb_dirList("dirList", false, NULL, NULL);
+kexPakFile *kex::cPakFiles = &pakFileLocal;
+
+#define FILE_MAX_HASH_SIZE  32768
+
+#define KPI_IDENT           "KPI1"
+#define KPI_VERSION         1
+
+//
+// pak index sidecar. laid out as the header, the hash bucket
+// starts, the bucket contents, the entries and the name pool
+//
+
+typedef struct
+{
+    char            ident[4];
+    int             version;
+    int             entrySize;
+    unsigned int    numfiles;
+    unsigned int    hashentries;
+    unsigned int    namesSize;
+    int64_t         archiveSize;
+    int64_t         archiveTime;
+    char            archive[MAX_FILEPATH];
+} kpiHeader_t;
+
+typedef struct
+{
+    unsigned int    nameOffset;
+    unsigned int    position;
+    unsigned int    localOffset;
+    unz_file_info   info;
+} kpiEntry_t;
+
+kexCvar kexPakFile::cvarParallelInflate("fs_parallelinflate", CVF_BOOL|CVF_CONFIG, "1",
+                                        "Inflate files on worker threads ahead of use");
+kexCvar kexPakFile::cvarCacheSize("fs_cachesize", CVF_INT|CVF_CONFIG, "32", 0, 1024,
+                                  "Memory budget in megabytes for decompressed files");
+
+//
+// statpakcache
+//
+
+COMMAND(statpakcache)
+{
+    kex::cPakFiles->PrintCacheStats();
+}
+
+//
+// kexPakFile::kexPakFile
+//
+
+kexPakFile::kexPakFile()
+{
+    numPrefetchThreads = 0;
+    prefetchMutex = NULL;
+    prefetchCond = NULL;
+    prefetchHead = 0;
+    bShutdownPrefetch = false;
+    cacheBytes = 0;
+    cacheHits = 0;
+    cacheMisses = 0;
+    cacheEvictions = 0;
+    filesRead = 0;
+    readTime = 0;
+    inflateTime = 0;
+    decodeTime = 0;
+    numDecoders = 0;
+}
+
+//
+// kexPakFile::~kexPakFile
+//
+
+kexPakFile::~kexPakFile()
+{
+}
+
+//
+// kexPakFile::Shutdown
+//
+
+void kexPakFile::Shutdown(void)
+{
+    kpf_t *pack;
+
+    kex::cSystem->Printf("Shutting down file system\n");
+
+    if(numPrefetchThreads > 0)
+    {
+        kex::cThread->LockMutex(prefetchMutex);
+        bShutdownPrefetch = true;
+        kex::cThread->ConditionBroadcast(prefetchCond);
+        kex::cThread->UnlockMutex(prefetchMutex);
+
+        for(int i = 0; i < numPrefetchThreads; ++i)
+        {
+            kex::cThread->WaitThread(prefetchThreads[i], NULL);
+        }
+
+        numPrefetchThreads = 0;
+
+        FlushPrefetches();
+
+        kex::cThread->ConditionDestroy(prefetchCond);
+        kex::cThread->DestroyMutex(prefetchMutex);
+    }
+
+    for(pack = root; pack; pack = pack->next)
+    {
+        UnmapZipFile(pack);
+        unzClose(pack->filehandle);
+    }
+
+    cacheList.Clear();
+    cacheBytes = 0;
+    Mem_Purge(hb_file);
+}
+
+//
+// kexPakFile::HashFileName
+//
+
+long kexPakFile::HashFileName(const char *fname, int hashSize) const
+{
+    unsigned int hash   = 0;
+    char *str           = (char*)fname;
+    char c;
+
+    while((c = *str++))
+    {
+        hash = c + (hash << 6) + (hash << 16) - hash;
+    }
+
+    return hash & (hashSize-1);
+}
+
+//
+// GetFileStamp
+//
+
+static bool GetFileStamp(const char *path, int64_t *size, int64_t *time)
+{
+#ifdef KEX_WIN32
+    WIN32_FILE_ATTRIBUTE_DATA data;
+
+    if(!GetFileAttributesExA(path, GetFileExInfoStandard, &data))
+    {
+        return false;
+    }
+
+    *size = ((int64_t)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+    *time = ((int64_t)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+#else
+    struct stat st;
+
+    if(stat(path, &st) != 0)
+    {
+        return false;
+    }
+
+    *size = (int64_t)st.st_size;
+    *time = (int64_t)st.st_mtime;
+#endif
+
+    return true;
+}
+
+//
+// kexPakFile::MapZipFile
+//
+// Maps the whole archive read-only so entries can be read (or for
+// stored entries, used directly) without going through stdio.
+// If this fails the pack is simply read through unzip as before
+//
+
+void kexPakFile::MapZipFile(kpf_t *pack)
+{
+    pack->mapData = NULL;
+    pack->mapSize = 0;
+    pack->mapHandle = NULL;
+
+#ifdef KEX_WIN32
+    HANDLE file;
+    HANDLE mapping;
+    DWORD size;
+
+    file = CreateFileA(pack->filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+                       OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+
+    if(file == INVALID_HANDLE_VALUE)
+    {
+        return;
+    }
+
+    size = GetFileSize(file, NULL);
+    mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(file);
+
+    if(mapping == NULL)
+    {
+        return;
+    }
+
+    if(!(pack->mapData = (byte*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)))
+    {
+        CloseHandle(mapping);
+        return;
+    }
+
+    pack->mapSize = (size_t)size;
+    pack->mapHandle = (void*)mapping;
+#else
+    struct stat st;
+    void *data;
+    int fd;
+
+    if((fd = open(pack->filename, O_RDONLY)) == -1)
+    {
+        return;
+    }
+
+    if(fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        close(fd);
+        return;
+    }
+
+    data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(data == MAP_FAILED)
+    {
+        return;
+    }
+
+    pack->mapData = (byte*)data;
+    pack->mapSize = (size_t)st.st_size;
+#endif
+}
+
+//
+// kexPakFile::UnmapZipFile
+//
+
+void kexPakFile::UnmapZipFile(kpf_t *pack)
+{
+    if(pack->mapData == NULL)
+    {
+        return;
+    }
+
+#ifdef KEX_WIN32
+    UnmapViewOfFile(pack->mapData);
+    CloseHandle((HANDLE)pack->mapHandle);
+#else
+    munmap(pack->mapData, pack->mapSize);
+#endif
+
+    pack->mapData = NULL;
+    pack->mapSize = 0;
+    pack->mapHandle = NULL;
+}
+
+//
+// kexPakFile::MappedEntry
+//
+// Returns the start of the entry's (possibly compressed) data
+// inside the mapping or NULL if it can't be reached that way
+//
+
+const byte *kexPakFile::MappedEntry(const kpf_t *pack, const file_t *file) const
+{
+    const byte *header;
+    unsigned int nameLength;
+    unsigned int extraLength;
+    size_t offset;
+
+    if(pack->mapData == NULL || file->localOffset + 30 > pack->mapSize)
+    {
+        return NULL;
+    }
+
+    header = pack->mapData + file->localOffset;
+
+    // local file header signature
+    if(header[0] != 'P' || header[1] != 'K' || header[2] != 3 || header[3] != 4)
+    {
+        return NULL;
+    }
+
+    nameLength  = header[26] | (header[27] << 8);
+    extraLength = header[28] | (header[29] << 8);
+    offset      = file->localOffset + 30 + nameLength + extraLength;
+
+    if(offset + file->info.compressed_size > pack->mapSize)
+    {
+        return NULL;
+    }
+
+    return pack->mapData + offset;
+}
+
+//
+// kexPakFile::ReadEntry
+//
+// Decompresses or copies an entry into out, which must be
+// able to hold the uncompressed size of the entry
+//
+
+bool kexPakFile::ReadEntry(const kpf_t *pack, const file_t *file, byte *out)
+{
+    const byte *entry;
+    uint64_t start;
+
+    if((entry = MappedEntry(pack, file)))
+    {
+        switch(file->info.compression_method)
+        {
+        case 0:
+            memcpy(out, entry, file->info.uncompressed_size);
+            return true;
+
+        case 8:
+            start = kex::cTimer->GetPerformanceCounter();
+
+            if(unzInflateBuffer(entry, file->info.compressed_size,
+                                out, file->info.uncompressed_size) == UNZ_OK)
+            {
+                inflateTime += kex::cTimer->GetPerformanceCounter() - start;
+                return true;
+            }
+            break;
+
+        default:
+            break;
+        }
+    }
+
+    unzSetCurrentFileInfoPosition(pack->filehandle, file->position);
+    unzOpenCurrentFile(pack->filehandle);
+    unzReadCurrentFile(pack->filehandle, out, file->info.uncompressed_size);
+    unzCloseCurrentFile(pack->filehandle);
+
+    return true;
+}
+
+//
+// kexPakFile::LoadZipFile
+//
+
+void kexPakFile::LoadZipFile(const char *file, const bool bUseBasePath)
+{
+    unzFile uf;
+    unz_global_info gi;
+    kpf_t *pack;
+    unsigned int entries;
+    const char *filepath;
+    kexStr fPath;
+    kexStr indexPath;
+    char *prefPath;
+    int64_t archiveSize;
+    int64_t archiveTime;
+
+    if(bUseBasePath)
+    {
+#ifndef _WIN32
+        filepath = SDL_GetPrefPath("", "ExhumedEXPlus");
+#else
+        filepath = SDL_GetBasePath();
 #endif
 
-static kexPakFile pakFileLocal;
-kexPakFile *kex::cPakFiles = &pakFileLocal;
+        fPath = filepath;
+        fPath = fPath + file;
+    }
+    else
+    {
+        fPath = file;
+    }
+
+    fPath.NormalizeSlashes();
+
+    kex::cSystem->Printf("kexPakFile::LoadZipFile: Loading %s\n", fPath.c_str());
+
+    // open zip file
+    if(!(uf = unzOpen(fPath.c_str())))
+    {
+        kex::cSystem->Error("kexPakFile::LoadZipFile: Unable to find %s", fPath.c_str());
+    }
+
+    // get info on zip file
+    if(unzGetGlobalInfo(uf, &gi) != UNZ_OK)
+    {
+        return;
+    }
+
+    // allocate new pack file
+    pack = (kpf_t*)Mem_Calloc(sizeof(kpf_t), hb_file);
+    pack->filehandle = (unzFile*)uf;
+    strcpy(pack->filename, fPath.c_str());
+    pack->numfiles = gi.number_entry;
+    pack->next = root;
+    root = pack;
+
+    MapZipFile(pack);
+
+    // setup hash entires
+    for(entries = 1; entries < FILE_MAX_HASH_SIZE; entries <<= 1)
+    {
+        if(entries > pack->numfiles)
+        {
+            break;
+        }
+    }
+
+    pack->hashentries = entries;
+
+    // mount from the index if the archive hasn't changed since it was written
+    // without a pref path the index is neither loaded nor saved
+    if( GetFileStamp(pack->filename, &archiveSize, &archiveTime) &&
+        (prefPath = SDL_GetPrefPath("", "ExhumedEXPlus")))
+    {
+        indexPath = kexStr(prefPath) + kexStr(pack->filename).StripPath() + ".kpi";
+        indexPath.NormalizeSlashes();
+        SDL_free(prefPath);
+
+        if(LoadIndex(pack, indexPath.c_str(), archiveSize, archiveTime))
+        {
+            AddToDirectories(pack);
+            return;
+        }
+    }
+
+    BuildIndex(pack);
+    AddToDirectories(pack);
+
+    if(indexPath.Length() > 0)
+    {
+        SaveIndex(pack, indexPath.c_str(), archiveSize, archiveTime);
+    }
+}
+
+//
+// kexPakFile::GetDirectory
+//
+// Looks up a directory node by its path, which is either empty for the
+// root or ends with a slash. Missing parents are created along with it
+//
+
+kexPakFile::dirNode_t *kexPakFile::GetDirectory(const char *path, const bool bCreate)
+{
+    dirNode_t **node;
+    dirNode_t *parent;
+    char parentPath[MAX_FILEPATH];
+    int len;
+
+    if((node = directories.Find(path)))
+    {
+        return *node;
+    }
+
+    if(!bCreate)
+    {
+        return NULL;
+    }
+
+    len = strlen(path);
+    parent = NULL;
+
+    if(len > 0)
+    {
+        // strip the last component, keeping the slash before it
+        for(len--; len > 0 && path[len-1] != '/'; len--);
+
+        strncpy(parentPath, path, len);
+        parentPath[len] = 0;
+
+        parent = GetDirectory(parentPath, true);
+    }
+
+    node = directories.Add(path, hb_file);
+    *node = (dirNode_t*)Mem_Calloc(sizeof(dirNode_t), hb_file);
+
+    if(parent)
+    {
+        (*node)->next = parent->children;
+        parent->children = *node;
+    }
+
+    return *node;
+}
+
+//
+// kexPakFile::AddToDirectories
+//
+// Files of newly mounted packs go in front of the ones already there,
+// matching the order FindFile searches the packs in. Files that replace
+// one from an older pack hide the older one from listings
+//
+
+void kexPakFile::AddToDirectories(kpf_t *pack)
+{
+    char path[MAX_FILEPATH];
+    const char *slash;
+    dirNode_t *dir;
+    int len;
+
+    for(unsigned int i = pack->numfiles; i-- > 0;)
+    {
+        file_t *fp = &pack->files[i];
+
+        if(fp->name[0] == '.' || kexStr::IndexOf(fp->name, ".") == -1)
+        {
+            continue;
+        }
+
+        for(kpf_t *p = pack->next; p; p = p->next)
+        {
+            file_t *older;
+
+            if((older = FindFileInPack(p, fp->name)))
+            {
+                older->bShadowed = true;
+            }
+        }
+
+        slash = strrchr(fp->name, '/');
+        len = slash ? (int)(slash - fp->name) + 1 : 0;
+
+        strncpy(path, fp->name, len);
+        path[len] = 0;
+
+        dir = GetDirectory(path, true);
+
+        fp->nextInDir = dir->files;
+        dir->files = fp;
+    }
+}
+
+//
+// kexPakFile::InitFile
+//
+
+void kexPakFile::InitFile(file_t *file)
+{
+    file->cache = NULL;
+    file->cacheRefs = 0;
+    file->cacheLink.Reset();
+    file->cacheLink.SetData(file);
+    file->prefetch = NULL;
+    file->nextInDir = NULL;
+    file->bShadowed = false;
+}
+
+//
+// kexPakFile::LoadIndex
+//
+// Mounts the pack from its index sidecar with a single read. Returns
+// false if there is no index or it was written for a different archive
+//
+
+bool kexPakFile::LoadIndex(kpf_t *pack, const char *indexFile, const int64_t size, const int64_t time)
+{
+    FILE *f;
+    long length;
+    byte *data;
+    kpiHeader_t *header;
+    const kpiEntry_t *entries;
+    const char *names;
+    unsigned int expected;
+
+    if(!(f = fopen(indexFile, "rb")))
+    {
+        return false;
+    }
+
+    fseek(f, 0, SEEK_END);
+    length = ftell(f);
+    fseek(f, 0, SEEK_SET);
+
+    if(length < (long)sizeof(kpiHeader_t))
+    {
+        fclose(f);
+        return false;
+    }
+
+    data = (byte*)Mem_Malloc(length, hb_file);
+
+    if(fread(data, 1, length, f) != (size_t)length)
+    {
+        fclose(f);
+        Mem_Free(data);
+        return false;
+    }
+
+    fclose(f);
+
+    header = (kpiHeader_t*)data;
+    expected = sizeof(kpiHeader_t) +
+        sizeof(int) * (header->hashentries + 1) +
+        sizeof(int) * header->numfiles +
+        sizeof(kpiEntry_t) * header->numfiles +
+        header->namesSize;
+
+    if( memcmp(header->ident, KPI_IDENT, 4) ||
+        header->version != KPI_VERSION ||
+        header->entrySize != sizeof(kpiEntry_t) ||
+        header->numfiles != pack->numfiles ||
+        header->hashentries != pack->hashentries ||
+        header->archiveSize != size ||
+        header->archiveTime != time ||
+        strcmp(header->archive, pack->filename) ||
+        (unsigned int)length != expected ||
+        header->namesSize == 0)
+    {
+        Mem_Free(data);
+        return false;
+    }
+
+    // the bucket arrays are used in place
+    pack->hashStart = (unsigned int*)(data + sizeof(kpiHeader_t));
+    pack->hashFiles = pack->hashStart + header->hashentries + 1;
+    entries = (kpiEntry_t*)(pack->hashFiles + header->numfiles);
+    names = (const char*)(entries + header->numfiles);
+
+    if(pack->hashStart[header->hashentries] != header->numfiles || names[header->namesSize-1] != 0)
+    {
+        Mem_Free(data);
+        return false;
+    }
+
+    // every bucket has to be a valid range of the table
+    for(unsigned int i = 0; i < header->hashentries; i++)
+    {
+        if(pack->hashStart[i] > pack->hashStart[i+1])
+        {
+            Mem_Free(data);
+            return false;
+        }
+    }
+
+    for(unsigned int i = 0; i < header->numfiles; i++)
+    {
+        if(pack->hashFiles[i] >= header->numfiles)
+        {
+            Mem_Free(data);
+            return false;
+        }
+    }
+
+    pack->files = (file_t*)Mem_Calloc(sizeof(file_t) * pack->numfiles, hb_file);
+
+    for(unsigned int i = 0; i < pack->numfiles; i++)
+    {
+        file_t *fp = &pack->files[i];
+        kpiEntry_t entry;
+
+        // entries aren't guaranteed to be aligned
+        memcpy(&entry, &entries[i], sizeof(kpiEntry_t));
+
+        if(entry.nameOffset >= header->namesSize)
+        {
+            Mem_Free(pack->files);
+            Mem_Free(data);
+            return false;
+        }
+
+        InitFile(fp);
+
+        strncpy(fp->name, names + entry.nameOffset, MAX_FILEPATH-1);
+        fp->position = entry.position;
+        fp->localOffset = entry.localOffset;
+        fp->info = entry.info;
+    }
+
+    return true;
+}
+
+//
+// kexPakFile::SaveIndex
+//
+
+void kexPakFile::SaveIndex(const kpf_t *pack, const char *indexFile, const int64_t size, const int64_t time)
+{
+    FILE *f;
+    kpiHeader_t header;
+    kpiEntry_t entry;
+    unsigned int nameOffset = 0;
+
+    if(!(f = fopen(indexFile, "wb")))
+    {
+        kex::cSystem->DPrintf("kexPakFile::SaveIndex: Couldn't write %s\n", indexFile);
+        return;
+    }
+
+    memset(&header, 0, sizeof(kpiHeader_t));
+    memcpy(header.ident, KPI_IDENT, 4);
+    header.version = KPI_VERSION;
+    header.entrySize = sizeof(kpiEntry_t);
+    header.numfiles = pack->numfiles;
+    header.hashentries = pack->hashentries;
+    header.archiveSize = size;
+    header.archiveTime = time;
+    strncpy(header.archive, pack->filename, MAX_FILEPATH-1);
+
+    for(unsigned int i = 0; i < pack->numfiles; i++)
+    {
+        header.namesSize += strlen(pack->files[i].name) + 1;
+    }
+
+    fwrite(&header, sizeof(kpiHeader_t), 1, f);
+    fwrite(pack->hashStart, sizeof(int), pack->hashentries + 1, f);
+    fwrite(pack->hashFiles, sizeof(int), pack->numfiles, f);
+
+    memset(&entry, 0, sizeof(kpiEntry_t));
+
+    for(unsigned int i = 0; i < pack->numfiles; i++)
+    {
+        const file_t *fp = &pack->files[i];
+
+        entry.nameOffset = nameOffset;
+        entry.position = fp->position;
+        entry.localOffset = fp->localOffset;
+        entry.info = fp->info;
+
+        fwrite(&entry, sizeof(kpiEntry_t), 1, f);
+        nameOffset += strlen(fp->name) + 1;
+    }
+
+    for(unsigned int i = 0; i < pack->numfiles; i++)
+    {
+        fwrite(pack->files[i].name, strlen(pack->files[i].name) + 1, 1, f);
+    }
+
+    fclose(f);
+}
+
+//
+// kexPakFile::BuildIndex
+//
+// Walks the central directory of the archive and fills in
+// the file list and the hash table
+//
+
+void kexPakFile::BuildIndex(kpf_t *pack)
+{
+    unz_file_info fi;
+    char filename[MAX_FILEPATH];
+    unsigned int *hashes;
+    unsigned int i;
+    long hash;
+
+    pack->files = (file_t*)Mem_Calloc(sizeof(file_t) * pack->numfiles, hb_file);
+    pack->hashStart = (unsigned int*)Mem_Calloc(sizeof(int) * (pack->hashentries+1), hb_file);
+    pack->hashFiles = (unsigned int*)Mem_Calloc(sizeof(int) * (pack->numfiles+1), hb_file);
+    hashes = (unsigned int*)Mem_Calloc(sizeof(int) * (pack->numfiles+1), hb_file);
+
+    // point to start of zip files
+    unzGoToFirstFile(pack->filehandle);
+
+    // fill in file lookup lists
+    for(i = 0; i < pack->numfiles; i++)
+    {
+        file_t *fp;
+
+        if(unzGetCurrentFileInfo(pack->filehandle, &fi, filename, sizeof(filename),
+                                 NULL, 0, NULL, 0) != UNZ_OK)
+        {
+            break;
+        }
+
+        fp = &pack->files[i];
+        InitFile(fp);
+
+        unzGetCurrentFileInfoPosition(pack->filehandle, &fp->position);
+        unzGetCurrentFileLocalOffset(pack->filehandle, &fp->localOffset);
+        strcpy(fp->name, filename);
+        fp->info = fi;
+
+        // get hash number
+        hash = HashFileName(filename, pack->hashentries);
+        hashes[i] = hash;
+        pack->hashStart[hash+1]++;
+
+        unzGoToNextFile(pack->filehandle);
+    }
+
+    pack->numfiles = i;
+
+    // turn the counts into bucket ends
+    for(i = 0; i < pack->hashentries; i++)
+    {
+        pack->hashStart[i+1] += pack->hashStart[i];
+    }
+
+    // drop each file into its bucket, walking the ends back to the starts
+    for(i = pack->numfiles; i-- > 0;)
+    {
+        pack->hashFiles[--pack->hashStart[hashes[i]+1]] = i;
+    }
+
+    for(i = 0; i < pack->hashentries; i++)
+    {
+        pack->hashStart[i] = pack->hashStart[i+1];
+    }
+
+    pack->hashStart[pack->hashentries] = pack->numfiles;
+
+    Mem_Free(hashes);
+}
+
+//
+// kexPakFile::FindFileInPack
+//
+
+kexPakFile::file_t *kexPakFile::FindFileInPack(const kpf_t *pack, const char *filename) const
+{
+    long hash = HashFileName(filename, pack->hashentries);
+
+    for(unsigned int i = pack->hashStart[hash]; i < pack->hashStart[hash+1]; i++)
+    {
+        file_t *fp = &pack->files[pack->hashFiles[i]];
+
+        if(!strcmp(fp->name, filename))
+        {
+            return fp;
+        }
+    }
+
+    return NULL;
+}
+
+//
+// kexPakFile::FindFile
+//
+
+bool kexPakFile::FindFile(const char *filename, kpf_t **pack, file_t **file) const
+{
+    for(kpf_t *p = root; p; p = p->next)
+    {
+        if((*file = FindFileInPack(p, filename)))
+        {
+            *pack = p;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//
+// kexPakFile::OpenFile
+//
+// Returns a copy of the file allocated from hb, which
+// the caller is responsible for freeing
+//
+
+int kexPakFile::OpenFile(const char *filename, byte **data, kexHeapBlock &hb)
+{
+    kpf_t *pack;
+    file_t *file;
+    byte *prefetched;
+    unsigned int size;
+    uint64_t start;
+
+    if(kex::cvarDeveloper.GetBool())
+    {
+        int len = OpenExternalFile(filename, data);
+
+        if(len != -1)
+        {
+            return len;
+        }
+    }
+
+    if(!FindFile(filename, &pack, &file))
+    {
+        *data = NULL;
+        return 0;
+    }
+
+    start = kex::cTimer->GetPerformanceCounter();
+
+    size = file->info.uncompressed_size;
+    *data = (byte*)Mem_Malloc(size+1, hb);
+
+    if(file->info.compression_method == 0 && MappedEntry(pack, file))
+    {
+        TakePrefetched(file, &prefetched);
+        ReadEntry(pack, file, *data);
+    }
+    else
+    {
+        memcpy(*data, CacheEntry(pack, file), size);
+        ReleaseCacheEntry(file);
+    }
+
+    (*data)[size] = 0;
+
+    filesRead++;
+    readTime += kex::cTimer->GetPerformanceCounter() - start;
+
+    return size;
+}
+
+//
+// kexPakFile::CacheEntry
+//
+// Returns the decompressed contents of the file, inflating it into the
+// cache if needed. The entry is pinned until ReleaseCacheEntry is called
+//
+
+byte *kexPakFile::CacheEntry(const kpf_t *pack, file_t *file)
+{
+    unsigned int size = file->info.uncompressed_size;
+    byte *prefetched;
+
+    if(file->cache)
+    {
+        cacheHits++;
+    }
+    else
+    {
+        cacheMisses++;
+        EvictCacheEntries(size);
+
+        if(TakePrefetched(file, &prefetched) && prefetched)
+        {
+            file->cache = prefetched;
+        }
+        else
+        {
+            file->cache = (byte*)Mem_Malloc(size+1, hb_file);
+            ReadEntry(pack, file, file->cache);
+            file->cache[size] = 0;
+        }
+
+        cacheBytes += size;
+    }
+
+    // move to the front of the list
+    file->cacheLink.Remove();
+    file->cacheLink.Add(cacheList);
+    file->cacheRefs++;
+
+    return file->cache;
+}
+
+//
+// kexPakFile::ReleaseCacheEntry
+//
+
+void kexPakFile::ReleaseCacheEntry(file_t *file)
+{
+    if(file->cacheRefs <= 0)
+    {
+        return;
+    }
+
+    file->cacheRefs--;
+
+    // pinned entries are allowed to push the cache over budget,
+    // so trim it back down once they are let go
+    if(file->cacheRefs == 0 && cacheBytes > (unsigned int)cvarCacheSize.GetInt() << 20)
+    {
+        EvictCacheEntries(0);
+    }
+}
+
+//
+// kexPakFile::EvictCacheEntries
+//
+// Frees the least recently used entries that aren't pinned
+// until there is room for size more bytes within the budget
+//
+
+void kexPakFile::EvictCacheEntries(const unsigned int size)
+{
+    unsigned int budget = (unsigned int)cvarCacheSize.GetInt() << 20;
+    file_t *file = cacheList.Prev();
+    file_t *prev;
+
+    while(file && cacheBytes + size > budget)
+    {
+        prev = file->cacheLink.Prev();
+
+        if(file->cacheRefs == 0)
+        {
+            cacheBytes -= file->info.uncompressed_size;
+            cacheEvictions++;
+
+            file->cacheLink.Remove();
+            Mem_Free(file->cache);
+            file->cache = NULL;
+        }
+
+        file = prev;
+    }
+}
+
+//
+// kexPakFile::PrintCacheStats
+//
+
+void kexPakFile::PrintCacheStats(void)
+{
+    unsigned int lookups = cacheHits + cacheMisses;
+    int numEntries = 0;
+    int numPinned = 0;
+
+    for(file_t *file = cacheList.Next(); file; file = file->cacheLink.Next())
+    {
+        numEntries++;
+
+        if(file->cacheRefs > 0)
+        {
+            numPinned++;
+        }
+    }
+
+    kex::cSystem->Printf("entries: %i (%i pinned)\n", numEntries, numPinned);
+    kex::cSystem->Printf("size: %ikb / %ikb\n", cacheBytes >> 10, cvarCacheSize.GetInt() << 10);
+    kex::cSystem->Printf("hits: %u\n", cacheHits);
+    kex::cSystem->Printf("misses: %u\n", cacheMisses);
+    kex::cSystem->Printf("evictions: %u\n", cacheEvictions);
+    kex::cSystem->Printf("hit rate: %.1f%%\n", lookups ? (float)cacheHits * 100.0f / (float)lookups : 0.0f);
+}
+
+//
+// kexPakFile::OpenFileView
+//
+// Returns a read-only view of the file. Stored entries point straight
+// into the mapped archive; compressed entries come out of the cache
+// and stay pinned until the view is handed back with CloseFileView
+//
+
+int kexPakFile::OpenFileView(const char *filename, byte **data)
+{
+    kpf_t *pack;
+    file_t *file;
+    const byte *entry;
+    uint64_t start;
+
+    if(kex::cvarDeveloper.GetBool())
+    {
+        int len = OpenExternalFile(filename, data);
+
+        if(len != -1)
+        {
+            return len;
+        }
+    }
+
+    if(!FindFile(filename, &pack, &file))
+    {
+        *data = NULL;
+        return 0;
+    }
+
+    start = kex::cTimer->GetPerformanceCounter();
+
+    if(file->info.compression_method == 0 && (entry = MappedEntry(pack, file)))
+    {
+        // a prefetch of a stored entry only pages it in
+        TakePrefetched(file, data);
+        *data = (byte*)entry;
+    }
+    else
+    {
+        *data = CacheEntry(pack, file);
+    }
+
+    filesRead++;
+    readTime += kex::cTimer->GetPerformanceCounter() - start;
+
+    return file->info.uncompressed_size;
+}
+
+//
+// kexPakFile::CloseFileView
+//
+
+void kexPakFile::CloseFileView(byte *data)
+{
+    if(data == NULL)
+    {
+        return;
+    }
+
+    for(kpf_t *pack = root; pack; pack = pack->next)
+    {
+        if(pack->mapData && data >= pack->mapData && data < pack->mapData + pack->mapSize)
+        {
+            return;
+        }
+    }
+
+    // recently opened views are near the front
+    for(file_t *file = cacheList.Next(); file; file = file->cacheLink.Next())
+    {
+        if(file->cache == data)
+        {
+            ReleaseCacheEntry(file);
+            return;
+        }
+    }
+
+    // came from OpenExternalFile
+    Mem_Free(data);
+}
+
+//
+// kexPakFile::PrefetchThread
+//
+
+int kexPakFile::PrefetchThread(void *data)
+{
+    kexPakFile *pak = (kexPakFile*)data;
+    prefetchJob_t *job;
+
+    kex::cThread->LockMutex(pak->prefetchMutex);
+
+    while(!pak->bShutdownPrefetch)
+    {
+        if(pak->prefetchHead >= pak->prefetchQueue.Length())
+        {
+            kex::cThread->ConditionWait(pak->prefetchCond, pak->prefetchMutex);
+            continue;
+        }
+
+        job = pak->prefetchQueue[pak->prefetchHead++];
 
-#define FILE_MAX_HASH_SIZE  32768
+        if(job == NULL)
+        {
+            // the game thread got to it first
+            continue;
+        }
+
+        job->state = PJ_RUNNING;
+        kex::cThread->UnlockMutex(pak->prefetchMutex);
+
+        pak->RunPrefetchJob(job);
+
+        kex::cThread->LockMutex(pak->prefetchMutex);
+        job->state = PJ_DONE;
+        kex::cThread->ConditionBroadcast(pak->prefetchCond);
+    }
+
+    kex::cThread->UnlockMutex(pak->prefetchMutex);
+    return 0;
+}
 
 //
-// kexPakFile::kexPakFile
+// kexPakFile::RunPrefetchJob
+//
+// Only ever touches the mapping and the job's own buffer,
+// so it is safe to run on any thread
 //
 
-kexPakFile::kexPakFile()
+void kexPakFile::RunPrefetchJob(prefetchJob_t *job)
 {
+    const byte *entry = MappedEntry(job->pack, job->file);
+    const unz_file_info *info = &job->file->info;
+    uint64_t start = kex::cTimer->GetPerformanceCounter();
+
+    if(job->data == NULL)
+    {
+        volatile byte touch = 0;
+
+        // stored entry; fault the pages in so the view is ready to use
+        for(unsigned long i = 0; i < info->uncompressed_size; i += 4096)
+        {
+            touch += entry[i];
+        }
+    }
+    else
+    {
+        // the buffer is freed back on the game thread
+        if(unzInflateBuffer(entry, info->compressed_size, job->data, info->uncompressed_size) != UNZ_OK)
+        {
+            job->bFailed = true;
+            return;
+        }
+
+        job->data[info->uncompressed_size] = 0;
+        job->time = kex::cTimer->GetPerformanceCounter() - start;
+        entry = job->data;
+    }
+
+    if(job->decoder)
+    {
+        start = kex::cTimer->GetPerformanceCounter();
+        job->decoded = job->decoder->decode(job->file->name, entry, info->uncompressed_size);
+        job->decodeTime = kex::cTimer->GetPerformanceCounter() - start;
+    }
 }
 
 //
-// kexPakFile::~kexPakFile
+// kexPakFile::OpenFileAsync
+//
+// Starts reading the file on a worker thread. The result is picked
+// up by the next OpenFile or OpenFileView on the same file, which
+// only blocks if the worker hasn't finished with it yet
 //
 
-kexPakFile::~kexPakFile()
+bool kexPakFile::OpenFileAsync(const char *filename)
 {
+    kpf_t *pack;
+    file_t *file;
+    prefetchJob_t *job;
+
+    if(numPrefetchThreads == 0 || !cvarParallelInflate.GetBool() || !FindFile(filename, &pack, &file))
+    {
+        return false;
+    }
+
+    if(file->cache || file->prefetch || !MappedEntry(pack, file))
+    {
+        return false;
+    }
+
+    if(file->info.compression_method != 0 && file->info.compression_method != 8)
+    {
+        return false;
+    }
+
+    // buffers come from the heap, which isn't thread safe, so
+    // allocate them here and let the worker only fill them in
+    job = (prefetchJob_t*)Mem_Malloc(sizeof(prefetchJob_t), hb_file);
+    job->pack = pack;
+    job->file = file;
+    job->state = PJ_QUEUED;
+    job->data = NULL;
+    job->decoder = NULL;
+    job->decoded = NULL;
+    job->bFailed = false;
+    job->time = 0;
+    job->decodeTime = 0;
+
+    for(int i = 0; i < numDecoders; ++i)
+    {
+        int extLength = strlen(decoders[i].ext);
+        int length = strlen(filename);
+
+        if(length >= extLength && !kexStr::Compare(filename + length - extLength, decoders[i].ext))
+        {
+            job->decoder = &decoders[i];
+            break;
+        }
+    }
+
+    if(file->info.compression_method != 0)
+    {
+        job->data = (byte*)Mem_Malloc(file->info.uncompressed_size+1, hb_file);
+    }
+
+    file->prefetch = job;
+
+    kex::cThread->LockMutex(prefetchMutex);
+
+    if(prefetchHead >= prefetchQueue.Length())
+    {
+        prefetchQueue.Empty();
+        prefetchHead = 0;
+    }
+
+    job->queueSlot = prefetchQueue.Length();
+    prefetchQueue.Push(job);
+    prefetchJobs.Push(job);
+
+    kex::cThread->ConditionBroadcast(prefetchCond);
+    kex::cThread->UnlockMutex(prefetchMutex);
+
+    return true;
 }
 
 //
-// kexPakFile::Shutdown
+// kexPakFile::PrefetchFiles
+//
+// Queues a batch of files on the worker threads so the rest of the
+// list inflates while the caller parses the first ones
 //
 
-void kexPakFile::Shutdown(void)
+void kexPakFile::PrefetchFiles(const kexStrList &files)
 {
-    kpf_t *pack;
+    for(unsigned int i = 0; i < files.Length(); ++i)
+    {
+        OpenFileAsync(files[i].c_str());
+    }
+}
 
-    kex::cSystem->Printf("Shutting down file system\n");
+//
+// kexPakFile::OpenFiles
+//
+// Opens a batch of files, inflating them in parallel on the worker
+// threads. Buffers are handed back in the same order as the list
+// and must be freed by the caller, same as with OpenFile
+//
 
-    for(pack = root; pack; pack = pack->next)
+void kexPakFile::OpenFiles(const kexStrList &files, kexArray<byte*> &data,
+                           kexArray<int> &lengths, kexHeapBlock &hb)
+{
+    PrefetchFiles(files);
+
+    data.Resize(files.Length());
+    lengths.Resize(files.Length());
+
+    for(unsigned int i = 0; i < files.Length(); ++i)
     {
-        unzClose(pack->filehandle);
+        lengths[i] = OpenFile(files[i].c_str(), &data[i], hb);
     }
+}
 
-    Mem_Purge(hb_file);
+//
+// kexPakFile::PrintLoadTimes
+//
+// Reports the time spent reading files since the last report. Blocked
+// time is what the game thread spent waiting on reads; inflate time is
+// the decompression work done on all threads combined
+//
+
+void kexPakFile::PrintLoadTimes(const char *label)
+{
+    kex::cSystem->Printf("%s: %u files, %.2fms blocked on reads, %.2fms inflating, %.2fms decoding (%i workers)\n",
+                         label, filesRead,
+                         kex::cTimer->MeasurePerformance(readTime),
+                         kex::cTimer->MeasurePerformance(inflateTime),
+                         kex::cTimer->MeasurePerformance(decodeTime),
+                         cvarParallelInflate.GetBool() ? numPrefetchThreads : 0);
+
+    filesRead = 0;
+    readTime = 0;
+    inflateTime = 0;
+    decodeTime = 0;
 }
 
 //
-// kexPakFile::HashFileName
+// kexPakFile::AddDecoder
+//
+// Files with the given extension that get prefetched are also run through
+// decode on the worker thread. decode must not touch the heap or anything
+// else shared with the game thread; returning NULL leaves the file to be
+// handled the usual way
 //
 
-long kexPakFile::HashFileName(const char *fname, int hashSize) const
+void kexPakFile::AddDecoder(const char *ext, decodeFunc_t decode, releaseFunc_t release)
 {
-    unsigned int hash   = 0;
-    char *str           = (char*)fname;
-    char c;
+    decoder_t *decoder;
 
-    while((c = *str++))
+    if(numDecoders >= MaxDecoders)
     {
-        hash = c + (hash << 6) + (hash << 16) - hash;
+        kex::cSystem->Warning("kexPakFile::AddDecoder: Too many decoders (%s)\n", ext);
+        return;
     }
 
-    return hash & (hashSize-1);
+    decoder = &decoders[numDecoders++];
+
+    strncpy(decoder->ext, ext, sizeof(decoder->ext)-1);
+    decoder->ext[sizeof(decoder->ext)-1] = 0;
+    decoder->decode = decode;
+    decoder->release = release;
 }
 
 //
-// kexPakFile::LoadZipFile
+// kexPakFile::TakeDecoded
+//
+// Hands over what the file's decoder produced on the worker thread,
+// waiting for it if needed. Returns NULL if the file wasn't prefetched
+// with a decoder or the decoder passed on it
 //
 
-void kexPakFile::LoadZipFile(const char *file, const bool bUseBasePath)
+void *kexPakFile::TakeDecoded(const char *filename)
 {
-    unzFile uf;
-    unz_global_info gi;
-    unz_file_info fi;
-    char filename[MAX_FILEPATH];
     kpf_t *pack;
-    unsigned int i;
-    unsigned int entries;
-    long hash;
-    const char *filepath;
-    kexStr fPath;
-
-    if(bUseBasePath)
-    {
-#ifndef _WIN32
-        filepath = SDL_GetPrefPath("", "ExhumedEXPlus");
-#else
-        filepath = SDL_GetBasePath();
-#endif
+    file_t *file;
+    prefetchJob_t *job;
+    uint64_t start;
+    void *decoded;
 
-        fPath = filepath;
-        fPath = fPath + file;
-    }
-    else
+    if(!FindFile(filename, &pack, &file) || file->prefetch == NULL || file->prefetch->decoder == NULL)
     {
-        fPath = file;
+        return NULL;
     }
 
-    fPath.NormalizeSlashes();
+    start = kex::cTimer->GetPerformanceCounter();
 
-    kex::cSystem->Printf("kexPakFile::LoadZipFile: Loading %s\n", fPath.c_str());
+    job = FinishPrefetch(file);
+    decoded = job->decoded;
 
-    // open zip file
-    if(!(uf = unzOpen(fPath.c_str())))
+    if(job->data)
     {
-        kex::cSystem->Error("kexPakFile::LoadZipFile: Unable to find %s", fPath.c_str());
+        Mem_Free(job->data);
     }
 
-    // get info on zip file
-    if(unzGetGlobalInfo(uf, &gi) != UNZ_OK)
+    Mem_Free(job);
+
+    if(decoded)
     {
-        return;
+        filesRead++;
+        readTime += kex::cTimer->GetPerformanceCounter() - start;
     }
 
-    // allocate new pack file
-    pack = (kpf_t*)Mem_Calloc(sizeof(kpf_t), hb_file);
-    pack->filehandle = (unzFile*)uf;
-    strcpy(pack->filename, fPath.c_str());
-    pack->numfiles = gi.number_entry;
-    pack->next = root;
-    root = pack;
+    return decoded;
+}
 
-    // point to start of zip files
-    unzGoToFirstFile(pack->filehandle);
+//
+// kexPakFile::FinishPrefetch
+//
+// Waits for the file's job (or runs it here if no worker has picked
+// it up) and detaches it from the file. The caller owns the job
+//
 
-    // setup hash entires
-    for(entries = 1; entries < FILE_MAX_HASH_SIZE; entries <<= 1)
+kexPakFile::prefetchJob_t *kexPakFile::FinishPrefetch(file_t *file)
+{
+    prefetchJob_t *job = file->prefetch;
+
+    if(job == NULL)
     {
-        if(entries > pack->numfiles)
-        {
-            break;
-        }
+        return NULL;
     }
 
-    // allocate file/hash list
-    pack->hashentries = entries;
-    pack->files = (file_t*)Mem_Calloc(sizeof(file_t) * pack->numfiles, hb_file);
-    pack->hashes = (file_t***)Mem_Calloc(sizeof(file_t**) * pack->hashentries, hb_file);
-    pack->hashcount = (unsigned int*)Mem_Calloc(sizeof(int) * pack->hashentries, hb_file);
+    kex::cThread->LockMutex(prefetchMutex);
 
-    // fill in file lookup lists
-    for(i = 0; i < pack->numfiles; i++)
+    if(job->state == PJ_QUEUED)
     {
-        file_t *fp;
+        // no worker has popped it yet, so take it out of the queue
+        // before the job can be freed
+        prefetchQueue[job->queueSlot] = NULL;
 
-        if(unzGetCurrentFileInfo(uf, &fi, filename, sizeof(filename),
-                                 NULL, 0, NULL, 0) != UNZ_OK)
-        {
-            break;
-        }
+        job->state = PJ_RUNNING;
+        kex::cThread->UnlockMutex(prefetchMutex);
 
-        pack->files[i].cache = NULL;
-        fp = &pack->files[i];
+        RunPrefetchJob(job);
 
-        unzGetCurrentFileInfoPosition(pack->filehandle, &fp->position);
-        strcpy(fp->name, filename);
-        fp->info = fi;
+        kex::cThread->LockMutex(prefetchMutex);
+        job->state = PJ_DONE;
+    }
 
-        // get hash number
-        hash = HashFileName(filename, pack->hashentries);
+    while(job->state != PJ_DONE)
+    {
+        kex::cThread->ConditionWait(prefetchCond, prefetchMutex);
+    }
 
-        // resize hash table if needed
-        pack->hashes[hash] = (file_t**)Mem_Realloc(
-                                 pack->hashes[hash],
-                                 sizeof(file_t*) * (pack->hashcount[hash]+1), hb_file);
+    for(unsigned int i = 0; i < prefetchJobs.Length(); ++i)
+    {
+        if(prefetchJobs[i] == job)
+        {
+            prefetchJobs[i] = prefetchJobs[prefetchJobs.Length()-1];
+            prefetchJobs.Pop();
+            break;
+        }
+    }
 
-        pack->hashes[hash][pack->hashcount[hash]++] = fp;
+    kex::cThread->UnlockMutex(prefetchMutex);
 
-        unzGoToNextFile(pack->filehandle);
+    if(job->bFailed)
+    {
+        Mem_Free(job->data);
+        job->data = NULL;
     }
+
+    inflateTime += job->time;
+    decodeTime += job->decodeTime;
+    file->prefetch = NULL;
+
+    return job;
 }
 
 //
-// kexPakFile::OpenFile
+// kexPakFile::TakePrefetched
+//
+// Returns false if the file was never prefetched. Otherwise hands
+// over the job's buffer, which is NULL for stored entries
 //
 
-int kexPakFile::OpenFile(const char *filename, byte **data, kexHeapBlock &hb) const
+bool kexPakFile::TakePrefetched(file_t *file, byte **data)
 {
-    long hash;
+    prefetchJob_t *job;
 
-    if(kex::cvarDeveloper.GetBool())
+    if(!(job = FinishPrefetch(file)))
     {
-        int len = OpenExternalFile(filename, data);
-
-        if(len != -1)
-        {
-            return len;
-        }
+        return false;
     }
 
-    for(kpf_t *pack = root; pack; pack = pack->next)
+    if(job->decoded)
     {
-        hash = HashFileName(filename, pack->hashentries);
+        // opened as a plain file, so nobody wants the decoded copy
+        job->decoder->release(job->decoded);
+    }
 
-        if(pack->hashes[hash])
-        {
-            unsigned int i;
+    *data = job->data;
+    Mem_Free(job);
 
-            for(i = 0; i < pack->hashcount[hash]; i++)
-            {
-                file_t *file = pack->hashes[hash][i];
-
-                if(!strcmp(file->name, filename))
-                {
-                    if(!file->cache)
-                    {
-                        file->cache = Mem_Malloc(file->info.uncompressed_size+1, hb);
-                        // automatically set cache to NULL when freed so we can
-                        // recache it later
-                        Mem_CacheRef(&file->cache);
-
-                        unzSetCurrentFileInfoPosition(pack->filehandle, file->position);
-                        unzOpenCurrentFile(pack->filehandle);
-                        unzReadCurrentFile(pack->filehandle, file->cache,
-                                           file->info.uncompressed_size);
-                        unzCloseCurrentFile(pack->filehandle);
-                    }
-
-                    *data = (byte*)file->cache;
-                    return file->info.uncompressed_size;
-                }
-            }
+    return true;
+}
+
+//
+// kexPakFile::FlushPrefetches
+//
+// Throws away everything that was prefetched but never opened
+//
+
+void kexPakFile::FlushPrefetches(void)
+{
+    byte *data;
+
+    while(prefetchJobs.Length() > 0)
+    {
+        if(TakePrefetched(prefetchJobs[prefetchJobs.Length()-1]->file, &data) && data)
+        {
+            Mem_Free(data);
         }
     }
-
-    *data = NULL;
-    return 0;
 }
 
 //
@@ -324,61 +1625,77 @@ void kexPakFile::GetMatchingExternalFiles(kexStrList &list, const char *search)
     }
 }
 
+//
+// kexPakFile::ListDirectory
+//
+
+void kexPakFile::ListDirectory(const dirNode_t *dir, kexStrList &list, kexHashList<int> *found)
+{
+    for(file_t *fp = dir->files; fp; fp = fp->nextInDir)
+    {
+        if(fp->bShadowed)
+        {
+            continue;
+        }
+
+        // check to make sure we don't open the same file twice if we
+        // already found it in the local directory
+        if(found && found->Find(fp->name))
+        {
+            kex::cSystem->DPrintf("Duplicate file found: %s\n", fp->name);
+            continue;
+        }
+
+        list.Push(fp->name);
+    }
+
+    for(const dirNode_t *child = dir->children; child; child = child->next)
+    {
+        ListDirectory(child, list, found);
+    }
+}
+
 //
 // kexPakFile::GetMatchingFiles
 //
+// Lists every file under the given directory and its subdirectories
+//
 
 void kexPakFile::GetMatchingFiles(kexStrList &list, const char *search)
 {
+    kexHashList<int> found;
+    kexStr path = search;
+    dirNode_t *dir;
+
     // for development mode, scan local directories that's not part of the pak file
     if(kex::cvarDeveloper.GetBool())
     {
         GetMatchingExternalFiles(list, search);
     }
 
-    // scan files inside pak files
-    for(kpf_t *pack = root; pack; pack = pack->next)
+    if(path.Length() > 0 && path[path.Length()-1] != '/')
     {
-        for(unsigned int i = 0; i < pack->numfiles; i++)
-        {
-            file_t *file = &pack->files[i];
+        path += "/";
+    }
 
-            if(strstr(file->name, search))
-            {
-                if(file->name[0] == '.')
-                {
-                    continue;
-                }
-
-                if(kexStr::IndexOf(file->name, ".") == -1)
-                {
-                    GetMatchingFiles(list, (kexStr(search) + file->name + "/").c_str());
-                    continue;
-                }
-
-                // check to make sure we don't open the same file twice if we
-                // already found it in the local directory
-                bool bFoundDupFile = false;
-
-                for(unsigned int j = 0; j < list.Length(); ++j)
-                {
-                    if(list[j] == file->name)
-                    {
-                        bFoundDupFile = true;
-                        break;
-                    }
-                }
-
-                if(bFoundDupFile)
-                {
-                    kex::cSystem->DPrintf("Duplicate file found: %s\n", file->name);
-                    continue;
-                }
-
-                list.Push(file->name);
-            }
-        }
+    if(!(dir = GetDirectory(path.c_str(), false)))
+    {
+        return;
+    }
+
+    if(list.Length() == 0)
+    {
+        ListDirectory(dir, list, NULL);
+        return;
     }
+
+    for(unsigned int i = 0; i < list.Length(); ++i)
+    {
+        found.Add(list[i].c_str(), hb_dirList);
+    }
+
+    ListDirectory(dir, list, &found);
+    Mem_Purge(hb_dirList);
 }
 
 //
@@ -421,5 +1738,25 @@ int kexPakFile::OpenExternalFile(const char *name, byte **buffer) const
 void kexPakFile::Init(void)
 {
     kex::cvarBasePath.Set(kex::cSystem->GetBaseDirectory());
+
+    // leave a core for the game thread
+    numPrefetchThreads = SDL_GetCPUCount() - 1;
+
+    if(numPrefetchThreads > MaxPrefetchThreads)
+    {
+        numPrefetchThreads = MaxPrefetchThreads;
+    }
+
+    if(numPrefetchThreads > 0)
+    {
+        prefetchMutex = kex::cThread->AllocMutex();
+        prefetchCond = kex::cThread->AllocCondition();
+
+        for(int i = 0; i < numPrefetchThreads; ++i)
+        {
+            prefetchThreads[i] = kex::cThread->CreateThread("prefetch", this, kexPakFile::PrefetchThread);
+        }
+    }
+
     kex::cSystem->Printf("File System Initialized\n");
 }
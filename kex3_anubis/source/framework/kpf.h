@@ -22,43 +22,155 @@
 class kexPakFile
 {
 public:
+    typedef void        *(*decodeFunc_t)(const char *filename, const byte *data, const unsigned int length);
+    typedef void        (*releaseFunc_t)(void *decoded);
+
     kexPakFile();
     ~kexPakFile();
 
     void                Shutdown(void);
     void                LoadUserFiles(void);
     void                LoadZipFile(const char *file, const bool bUseBasePath = true);
-    int                 OpenFile(const char *filename, byte **data, kexHeapBlock &hb) const;
+    int                 OpenFile(const char *filename, byte **data, kexHeapBlock &hb);
+    int                 OpenFileView(const char *filename, byte **data);
+    void                CloseFileView(byte *data);
+    bool                OpenFileAsync(const char *filename);
+    void                PrefetchFiles(const kexStrList &files);
+    void                FlushPrefetches(void);
+    void                AddDecoder(const char *ext, decodeFunc_t decode, releaseFunc_t release);
+    void                *TakeDecoded(const char *filename);
+    void                OpenFiles(const kexStrList &files, kexArray<byte*> &data,
+                                  kexArray<int> &lengths, kexHeapBlock &hb);
     int                 OpenExternalFile(const char *name, byte **buffer) const;
     void                GetMatchingFiles(kexStrList &list, const char *search);
     void                GetMatchingExternalFiles(kexStrList &list, const char *search);
+    void                PrintCacheStats(void);
+    void                PrintLoadTimes(const char *label);
     void                Init(void);
 
+    static kexCvar      cvarCacheSize;
+    static kexCvar      cvarParallelInflate;
+
 private:
-    long                HashFileName(const char *fname, int hashSize) const;
+    struct prefetchJob_s;
 
-    typedef struct
+    typedef struct file_s
     {
         char            name[MAX_FILEPATH];
         unsigned long   position;
+        unsigned long   localOffset;
         unz_file_info   info;
-        void*           cache;
+        byte            *cache;
+        int             cacheRefs;
+        kexLinklist<struct file_s> cacheLink;
+        struct prefetchJob_s *prefetch;
+        struct file_s   *nextInDir;
+        bool            bShadowed;
     } file_t;
 
+    typedef struct dirNode_s
+    {
+        file_t          *files;
+        struct dirNode_s *children;
+        struct dirNode_s *next;
+    } dirNode_t;
+
     typedef struct kpf_s
     {
         unzFile         *filehandle;
         unsigned int    numfiles;
         char            filename[MAX_FILEPATH];
         file_t          *files;
-        file_t          ***hashes;
-        unsigned int    *hashcount;
+        unsigned int    *hashStart;
+        unsigned int    *hashFiles;
         unsigned int    hashentries;
+        byte            *mapData;
+        size_t          mapSize;
+        void            *mapHandle;
         struct kpf_s    *next;
     } kpf_t;
 
+    typedef struct
+    {
+        char            ext[8];
+        decodeFunc_t    decode;
+        releaseFunc_t   release;
+    } decoder_t;
+
+    typedef enum
+    {
+        PJ_QUEUED   = 0,
+        PJ_RUNNING,
+        PJ_DONE
+    } prefetchState_t;
+
+    typedef struct prefetchJob_s
+    {
+        kpf_t           *pack;
+        file_t          *file;
+        byte            *data;
+        const decoder_t *decoder;
+        void            *decoded;
+        bool            bFailed;
+        uint64_t        time;
+        uint64_t        decodeTime;
+        unsigned int    queueSlot;
+        prefetchState_t state;
+    } prefetchJob_t;
+
+    long                HashFileName(const char *fname, int hashSize) const;
+    file_t              *FindFileInPack(const kpf_t *pack, const char *filename) const;
+    bool                FindFile(const char *filename, kpf_t **pack, file_t **file) const;
+    dirNode_t           *GetDirectory(const char *path, const bool bCreate);
+    void                AddToDirectories(kpf_t *pack);
+    void                ListDirectory(const dirNode_t *dir, kexStrList &list, kexHashList<int> *found);
+    void                InitFile(file_t *file);
+    void                BuildIndex(kpf_t *pack);
+    bool                LoadIndex(kpf_t *pack, const char *indexFile, const int64_t size, const int64_t time);
+    void                SaveIndex(const kpf_t *pack, const char *indexFile, const int64_t size, const int64_t time);
+    void                MapZipFile(kpf_t *pack);
+    void                UnmapZipFile(kpf_t *pack);
+    const byte          *MappedEntry(const kpf_t *pack, const file_t *file) const;
+    bool                ReadEntry(const kpf_t *pack, const file_t *file, byte *out);
+    byte                *CacheEntry(const kpf_t *pack, file_t *file);
+    void                ReleaseCacheEntry(file_t *file);
+    void                EvictCacheEntries(const unsigned int size);
+    prefetchJob_t       *FinishPrefetch(file_t *file);
+    bool                TakePrefetched(file_t *file, byte **data);
+    void                RunPrefetchJob(prefetchJob_t *job);
+
+    static int          PrefetchThread(void *data);
+
+    static const int    MaxPrefetchThreads = 4;
+    static const int    MaxDecoders = 4;
+
     kpf_t               *root;
     char                *base;
+
+    kexHashList<dirNode_t*> directories;
+
+    kexLinklist<file_t> cacheList;
+    unsigned int        cacheBytes;
+    unsigned int        cacheHits;
+    unsigned int        cacheMisses;
+    unsigned int        cacheEvictions;
+
+    unsigned int        filesRead;
+    uint64_t            readTime;
+    uint64_t            inflateTime;
+    uint64_t            decodeTime;
+
+    decoder_t           decoders[MaxDecoders];
+    int                 numDecoders;
+
+    kexThread::kThread_t prefetchThreads[MaxPrefetchThreads];
+    int                 numPrefetchThreads;
+    kexThread::kMutex_t prefetchMutex;
+    kexThread::kCond_t  prefetchCond;
+    kexArray<prefetchJob_t*> prefetchQueue;
+    kexArray<prefetchJob_t*> prefetchJobs;
+    unsigned int        prefetchHead;
+    bool                bShutdownPrefetch;
 };
 
 #endif
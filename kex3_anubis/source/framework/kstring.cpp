@@ -113,6 +113,29 @@ kexStr::kexStr(const kexStr &string)
     CopyNew(string.charPtr, string.Length());
 }
 
+//
+// kexStr::kexStr
+//
+// Takes over the other string's buffer if it lives on the heap
+//
+
+kexStr::kexStr(kexStr &&string)
+{
+    Init();
+
+    if(string.charPtr == string.defaultBuffer)
+    {
+        CopyNew(string.charPtr, string.Length());
+        return;
+    }
+
+    charPtr = string.charPtr;
+    length = string.length;
+    bufferLength = string.bufferLength;
+
+    string.Init();
+}
+
 //
 // kexStr::~kexStr
 //
@@ -227,6 +250,35 @@ kexStr &kexStr::operator=(const kexStr &str)
 // kexStr::operator=
 //
 
+kexStr &kexStr::operator=(kexStr &&str)
+{
+    if(this == &str)
+    {
+        return *this;
+    }
+
+    if(str.charPtr == str.defaultBuffer)
+    {
+        return *this = static_cast<const kexStr&>(str);
+    }
+
+    if(charPtr != defaultBuffer)
+    {
+        delete[] charPtr;
+    }
+
+    charPtr = str.charPtr;
+    length = str.length;
+    bufferLength = str.bufferLength;
+
+    str.Init();
+    return *this;
+}
+
+//
+// kexStr::operator=
+//
+
 kexStr &kexStr::operator=(const char *str)
 {
     int len = strlen(str);
@@ -264,7 +316,8 @@ kexStr kexStr::operator+(const kexStr &str)
 {
     kexStr out(*this);
 
-    return out.Concat(str.c_str());
+    out.Concat(str.c_str());
+    return out;
 }
 
 //
@@ -275,7 +328,8 @@ kexStr kexStr::operator+(const char *str)
 {
     kexStr out(*this);
 
-    return out.Concat(str);
+    out.Concat(str);
+    return out;
 }
 
 //
@@ -286,7 +340,8 @@ kexStr kexStr::operator+(const bool b)
 {
     kexStr out(*this);
 
-    return out.Concat(b ? "true" : "false");
+    out.Concat(b ? "true" : "false");
+    return out;
 }
 
 //
@@ -300,7 +355,8 @@ kexStr kexStr::operator+(const int i)
     char tmp[64];
     sprintf(tmp, "%i", i);
 
-    return out.Concat(tmp);
+    out.Concat(tmp);
+    return out;
 }
 
 //
@@ -314,7 +370,8 @@ kexStr kexStr::operator+(const float f)
     char tmp[64];
     sprintf(tmp, "%f", f);
 
-    return out.Concat(tmp);
+    out.Concat(tmp);
+    return out;
 }
 
 //
@@ -375,6 +432,13 @@ void kexStr::Resize(int size, bool bKeepString)
         return;
     }
 
+    // strings that are being appended to grow geometrically
+    // so building one a character at a time stays linear
+    if(bKeepString && size < bufferLength * 2)
+    {
+        size = bufferLength * 2;
+    }
+
     int newsize = size + ((32 - (size & 31)) & 31);
     char *newbuffer = new char[newsize];
 
@@ -763,9 +827,13 @@ void kexStr::WriteToFile(const char *file)
         return;
     }
 
-    FILE *f = fopen(file, "w");
-    fprintf(f, "%s", charPtr);
-    fclose(f);
+    kexBinFile binFile;
+
+    if(binFile.Create(file))
+    {
+        binFile.WriteBytes((const byte*)charPtr, length);
+        binFile.Close();
+    }
 }
 
 //
@@ -870,3 +938,184 @@ bool kexStr::Compare(const kexStr &a, const kexStr &b)
 {
     return Compare(a.c_str(), b.c_str());
 }
+
+//=============================================================================
+//
+// kexAtom
+//
+// The table is built from plain statics and malloc so that atoms
+// can be created by static constructors before the heap exists
+//
+//=============================================================================
+
+static char **atomNames = NULL;
+static int numAtoms = 0;
+static int maxAtoms = 0;
+
+static int *atomSlots = NULL;
+static unsigned int *atomHashes = NULL;
+static unsigned int atomMask = 0;
+
+//
+// AtomHash
+//
+
+static unsigned int AtomHash(const char *s)
+{
+    unsigned int hash = 0;
+    char c;
+
+    while((c = *s++))
+    {
+        hash = c + (hash << 6) + (hash << 16) - hash;
+    }
+
+    return hash;
+}
+
+//
+// AtomSlot
+//
+// Returns the slot that holds the string or the empty
+// slot where it would be inserted
+//
+
+static unsigned int AtomSlot(const char *string, const unsigned int hash)
+{
+    unsigned int i;
+
+    for(i = hash & atomMask; atomSlots[i] != -1; i = (i + 1) & atomMask)
+    {
+        if(atomHashes[i] == hash && !strcmp(atomNames[atomSlots[i]], string))
+        {
+            break;
+        }
+    }
+
+    return i;
+}
+
+//
+// AtomGrow
+//
+
+static void AtomGrow(void)
+{
+    unsigned int size = atomSlots ? (atomMask + 1) * 2 : 1024;
+    int *oldSlots = atomSlots;
+    unsigned int *oldHashes = atomHashes;
+    unsigned int oldSize = oldSlots ? atomMask + 1 : 0;
+
+    atomSlots = (int*)malloc(sizeof(int) * size);
+    atomHashes = (unsigned int*)malloc(sizeof(unsigned int) * size);
+    atomMask = size - 1;
+
+    memset(atomSlots, 0xff, sizeof(int) * size);
+
+    for(unsigned int i = 0; i < oldSize; ++i)
+    {
+        if(oldSlots[i] != -1)
+        {
+            unsigned int j = AtomSlot(atomNames[oldSlots[i]], oldHashes[i]);
+
+            atomSlots[j] = oldSlots[i];
+            atomHashes[j] = oldHashes[i];
+        }
+    }
+
+    free(oldSlots);
+    free(oldHashes);
+
+    maxAtoms = (size >> 1) + (size >> 2);
+    atomNames = (char**)realloc(atomNames, sizeof(char*) * maxAtoms);
+}
+
+//
+// kexAtom::Intern
+//
+
+int kexAtom::Intern(const char *string)
+{
+    unsigned int hash;
+    unsigned int slot;
+    int len;
+
+    if(string == NULL)
+    {
+        string = "";
+    }
+
+    if(atomSlots == NULL)
+    {
+        AtomGrow();
+
+        // reserve id 0 for the empty string
+        atomNames[0] = (char*)calloc(1, 1);
+        slot = AtomSlot("", AtomHash(""));
+        atomSlots[slot] = 0;
+        atomHashes[slot] = AtomHash("");
+        numAtoms = 1;
+    }
+
+    hash = AtomHash(string);
+    slot = AtomSlot(string, hash);
+
+    if(atomSlots[slot] != -1)
+    {
+        return atomSlots[slot];
+    }
+
+    if(numAtoms >= maxAtoms)
+    {
+        AtomGrow();
+        slot = AtomSlot(string, hash);
+    }
+
+    len = strlen(string);
+    atomNames[numAtoms] = (char*)malloc(len + 1);
+    memcpy(atomNames[numAtoms], string, len + 1);
+
+    atomSlots[slot] = numAtoms;
+    atomHashes[slot] = hash;
+
+    return numAtoms++;
+}
+
+//
+// kexAtom::Find
+//
+// Returns -1 if the string was never interned
+//
+
+int kexAtom::Find(const char *string)
+{
+    if(atomSlots == NULL || string == NULL)
+    {
+        return -1;
+    }
+
+    return atomSlots[AtomSlot(string, AtomHash(string))];
+}
+
+//
+// kexAtom::Name
+//
+
+const char *kexAtom::Name(const int id)
+{
+    if(id < 0 || id >= numAtoms)
+    {
+        return "";
+    }
+
+    return atomNames[id];
+}
+
+//
+// kexAtom::NumAtoms
+//
+
+int kexAtom::NumAtoms(void)
+{
+    return numAtoms;
+}
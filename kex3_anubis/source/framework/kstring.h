@@ -30,6 +30,7 @@ public:
     kexStr(const char *string);
     kexStr(const char *string, const int length);
     kexStr(const kexStr &string);
+    kexStr(kexStr &&string);
     ~kexStr(void);
 
     void                Clear(void);
@@ -60,6 +61,7 @@ public:
     const char          *c_str(void) const { return charPtr; }
 
     kexStr              &operator=(const kexStr &str);
+    kexStr              &operator=(kexStr &&str);
     kexStr              &operator=(const char *str);
     kexStr              &operator=(const bool b);
     kexStr              operator+(const kexStr &str);
@@ -99,7 +101,7 @@ private:
 protected:
     void                Init(void);
 
-    static const int    STRING_DEFAULT_SIZE = 32;
+    static const int    STRING_DEFAULT_SIZE = 64;
 
     char                *charPtr;
     char                defaultBuffer[STRING_DEFAULT_SIZE];
@@ -107,6 +109,37 @@ protected:
     int                 bufferLength;
 };
 
+//
+// Interned string. Every distinct string maps to a stable integer id
+// for the life of the program, so names that are looked up at runtime
+// can be resolved once and compared as integers from then on. Id 0 is
+// always the empty string.
+//
+class kexAtom
+{
+public:
+    kexAtom(void) : id(0) {}
+    explicit kexAtom(const char *string) : id(Intern(string)) {}
+    explicit kexAtom(const kexStr &string) : id(Intern(string.c_str())) {}
+
+    kexAtom             &operator=(const char *string) { id = Intern(string); return *this; }
+    kexAtom             &operator=(const kexStr &string) { id = Intern(string.c_str()); return *this; }
+    bool                operator==(const kexAtom &atom) const { return id == atom.id; }
+    bool                operator!=(const kexAtom &atom) const { return id != atom.id; }
+
+    const int           ID(void) const { return id; }
+    const char          *c_str(void) const { return Name(id); }
+    const bool          IsEmpty(void) const { return id == 0; }
+
+    static int          Intern(const char *string);
+    static int          Find(const char *string);
+    static const char   *Name(const int id);
+    static int          NumAtoms(void);
+
+private:
+    int                 id;
+};
+
 d_inline bool operator==(const kexStr &a, const kexStr &b)
 {
     return (!strcmp(a.charPtr, b.charPtr));
@@ -24,6 +24,16 @@ bool kexHeap::bDrawHeapInfo = false;
 kexHeapBlock *kexHeap::currentHeapBlock = NULL;
 kexHeapBlock *kexHeap::blockList = NULL;
 
+memArenaChunk_t *kexHeap::arenaChunks = NULL;
+memArenaChunk_t *kexHeap::arenaCurrent = NULL;
+int kexHeap::arenaUsed = 0;
+int kexHeap::arenaPeak = 0;
+
+bool kexHeap::bTrackCallSites = false;
+memCallSite_t kexHeap::callSites[kexHeap::MaxCallSites];
+int kexHeap::numCallSites = 0;
+short kexHeap::callSiteHash[kexHeap::CallSiteHashSize];
+
 //
 // common heap block types
 //
@@ -32,6 +42,8 @@ kexHeapBlock hb_auto("auto", false, NULL, NULL);
 kexHeapBlock hb_file("file", false, NULL, NULL);
 kexHeapBlock hb_object("object", false, NULL, NULL);
 
+static kexHeapBlock hb_benchmark("benchmark", false, NULL, NULL);
+
 //
 // statheap
 //
@@ -41,6 +53,100 @@ COMMAND(statheap)
     kexHeap::bDrawHeapInfo ^= 1;
 }
 
+//
+// trackallocs
+//
+
+COMMAND(trackallocs)
+{
+    kexHeap::bTrackCallSites ^= 1;
+    kex::cSystem->Printf("allocation tracking %s\n", kexHeap::bTrackCallSites ? "on" : "off");
+}
+
+//
+// dumpallocs
+//
+
+COMMAND(dumpallocs)
+{
+    kexStr path;
+
+    if(kex::cCommands->GetArgc() >= 2)
+    {
+        path = kexStr::Format("%s\\%s", kex::cvarBasePath.GetValue(), kex::cCommands->GetArgv(1));
+    }
+    else
+    {
+        path = kexStr::Format("%s\\allocs.csv", kex::cvarBasePath.GetValue());
+    }
+
+    path.NormalizeSlashes();
+
+    if(kexHeap::DumpCallSites(path.c_str()))
+    {
+        kex::cSystem->Printf("wrote %i call sites to %s\n", kexHeap::numCallSites, path.c_str());
+    }
+}
+
+//
+// benchheap
+//
+// Runs the same allocation pattern through the slab pools
+// and through the system allocator and prints the timings
+//
+
+COMMAND(benchheap)
+{
+    int count = 50000;
+    void **ptrs;
+    uint64_t time;
+
+    if(kex::cCommands->GetArgc() >= 2)
+    {
+        count = atoi(kex::cCommands->GetArgv(1));
+    }
+
+    if(count <= 0)
+    {
+        kex::cSystem->Printf("benchheap <allocations>\n");
+        return;
+    }
+
+    ptrs = (void**)malloc(sizeof(void*) * count);
+
+    for(int pass = 0; pass < 2; pass++)
+    {
+        hb_benchmark.bPooled = (pass == 0);
+        time = kex::cTimer->GetPerformanceCounter();
+
+        for(int i = 0; i < count; i++)
+        {
+            ptrs[i] = Mem_Malloc(8 + ((i * 7919) % 504), hb_benchmark);
+        }
+
+        // free every other block and allocate them again
+        for(int i = 0; i < count; i += 2)
+        {
+            Mem_Free(ptrs[i]);
+        }
+
+        for(int i = 0; i < count; i += 2)
+        {
+            ptrs[i] = Mem_Malloc(8 + ((i * 104729) % 504), hb_benchmark);
+        }
+
+        Mem_Purge(hb_benchmark);
+
+        time = kex::cTimer->GetPerformanceCounter() - time;
+        kex::cSystem->Printf("%s: %i allocations in %fms\n",
+                             hb_benchmark.bPooled ? "pooled" : "system",
+                             count + (count >> 1), kex::cTimer->MeasurePerformance(time));
+    }
+
+    hb_benchmark.bPooled = true;
+    free(ptrs);
+}
+
 //
 // kexHeapBlock::kexHeapBlock
 //
@@ -55,6 +161,12 @@ kexHeapBlock::kexHeapBlock(const char *name, bool bGarbageCollect,
     this->bGC           = bGarbageCollect;
     this->purgeID       = kexHeap::numHeapBlocks++;
     this->numAllocated  = 0;
+    this->numBlocks     = 0;
+    this->numBytes      = 0;
+    this->bPooled       = true;
+    this->slabs         = NULL;
+
+    memset(this->freeBlocks, 0, sizeof(this->freeBlocks));
 
     // add heap block to main block list
     if(kexHeap::blockList)
@@ -139,6 +251,8 @@ void kexHeap::AddBlock(memBlock_t *block, kexHeapBlock *heapBlock)
     }
 
     heapBlock->numAllocated++;
+    heapBlock->numBlocks++;
+    heapBlock->numBytes += block->size;
 }
 
 //
@@ -161,9 +275,152 @@ void kexHeap::RemoveBlock(memBlock_t *block)
         block->next->prev = block->prev;
     }
 
+    block->heapBlock->numBlocks--;
+    block->heapBlock->numBytes -= block->size;
     block->heapBlock = NULL;
 }
 
+//
+// kexHeap::TrackAlloc
+//
+// Records the allocation against the file and line that
+// requested it. Sites are looked up by the contents of the
+// file string, since code inlined from headers passes a
+// different __FILE__ literal for every translation unit
+//
+
+void kexHeap::TrackAlloc(memBlock_t *block, const char *file, int line)
+{
+    memCallSite_t *site;
+    unsigned int hash;
+    int index;
+
+    block->callSite = -1;
+
+    if(!kexHeap::bTrackCallSites)
+    {
+        return;
+    }
+
+    hash = line;
+
+    for(const char *c = file; *c; ++c)
+    {
+        hash = hash * 31 + *c;
+    }
+
+    hash &= (kexHeap::CallSiteHashSize-1);
+
+    while((index = callSiteHash[hash] - 1) >= 0)
+    {
+        if( callSites[index].line == line &&
+            (callSites[index].file == file || !strcmp(callSites[index].file, file)))
+        {
+            break;
+        }
+
+        hash = (hash + 1) & (kexHeap::CallSiteHashSize-1);
+    }
+
+    if(index < 0)
+    {
+        if(numCallSites >= kexHeap::MaxCallSites)
+        {
+            return;
+        }
+
+        index = numCallSites++;
+        callSiteHash[hash] = index + 1;
+
+        site = &callSites[index];
+        memset(site, 0, sizeof(memCallSite_t));
+        site->file = file;
+        site->line = line;
+    }
+
+    site = &callSites[index];
+    site->count++;
+    site->numBlocks++;
+    site->bytes += block->size;
+    site->totalBytes += block->size;
+
+    if(site->bytes > site->peakBytes)
+    {
+        site->peakBytes = site->bytes;
+    }
+
+    block->callSite = index;
+}
+
+//
+// kexHeap::TrackFree
+//
+
+void kexHeap::TrackFree(memBlock_t *block)
+{
+    memCallSite_t *site;
+
+    if(block->callSite < 0)
+    {
+        return;
+    }
+
+    site = &callSites[block->callSite];
+    site->numBlocks--;
+    site->bytes -= block->size;
+}
+
+//
+// kexHeap::DumpCallSites
+//
+// Writes the call site table to a CSV file, largest
+// peak usage first
+//
+
+static int SortCallSites(const void *a, const void *b)
+{
+    const memCallSite_t *x = &kexHeap::callSites[*(const int*)a];
+    const memCallSite_t *y = &kexHeap::callSites[*(const int*)b];
+
+    return (y->peakBytes > x->peakBytes) - (y->peakBytes < x->peakBytes);
+}
+
+bool kexHeap::DumpCallSites(const char *file)
+{
+    FILE *f;
+    int *order;
+
+    if(!(f = fopen(file, "w")))
+    {
+        kex::cSystem->Warning("kexHeap::DumpCallSites: couldn't write %s\n", file);
+        return false;
+    }
+
+    order = (int*)malloc(sizeof(int) * MAX(numCallSites, 1));
+
+    for(int i = 0; i < numCallSites; i++)
+    {
+        order[i] = i;
+    }
+
+    qsort(order, numCallSites, sizeof(int), SortCallSites);
+
+    fprintf(f, "file,line,count,blocks,bytes,peak_bytes,total_bytes\n");
+
+    for(int i = 0; i < numCallSites; i++)
+    {
+        memCallSite_t *site = &callSites[order[i]];
+
+        fprintf(f, "\"%s\",%i,%i,%i,%i,%i,%llu\n", site->file, site->line, site->count,
+                site->numBlocks, site->bytes, site->peakBytes, (unsigned long long)site->totalBytes);
+    }
+
+    free(order);
+    fclose(f);
+
+    return true;
+}
+
 //
 // kexHeap::GetBlock
 //
@@ -182,6 +439,109 @@ memBlock_t *kexHeap::GetBlock(void *ptr, const char *file, int line)
     return block;
 }
 
+//
+// kexHeap::PoolClass
+//
+// Returns the smallest size class that can hold the
+// requested size or MEM_POOL_NONE if it is too large
+//
+
+int kexHeap::PoolClass(const int size)
+{
+    int poolClass = 0;
+
+    if(size > kexHeap::PoolMaxSize)
+    {
+        return MEM_POOL_NONE;
+    }
+
+    while((kexHeap::PoolMinSize << poolClass) < size)
+    {
+        poolClass++;
+    }
+
+    return poolClass;
+}
+
+//
+// kexHeap::PoolAlloc
+//
+// Pops a block from the size class's free list, carving
+// up a new slab if the list is empty
+//
+
+memBlock_t *kexHeap::PoolAlloc(kexHeapBlock *heapBlock, const int poolClass,
+                               const char *file, int line)
+{
+    memBlock_t *block;
+
+    if(heapBlock->freeBlocks[poolClass] == NULL)
+    {
+        int headerSize = (sizeof(memSlab_t) + 15) & ~15;
+        int blockSize = sizeof(memBlock_t) + (kexHeap::PoolMinSize << poolClass);
+        int numBlocks = (kexHeap::SlabSize - headerSize) / blockSize;
+        memSlab_t *slab;
+        byte *data;
+
+        if(!(slab = (memSlab_t*)malloc(kexHeap::SlabSize)))
+        {
+            kex::cSystem->Error("kexHeap::PoolAlloc: failed on allocation of slab (%s:%d)", file, line);
+        }
+
+        slab->poolClass = poolClass;
+        slab->next = heapBlock->slabs;
+        heapBlock->slabs = slab;
+
+        data = ((byte*)slab) + headerSize;
+
+        for(int i = 0; i < numBlocks; i++)
+        {
+            block = (memBlock_t*)(data + (i * blockSize));
+            block->heapTag = 0;
+            block->poolClass = poolClass;
+            block->next = heapBlock->freeBlocks[poolClass];
+            heapBlock->freeBlocks[poolClass] = block;
+        }
+    }
+
+    block = heapBlock->freeBlocks[poolClass];
+    heapBlock->freeBlocks[poolClass] = block->next;
+
+    return block;
+}
+
+//
+// kexHeap::PoolFree
+//
+
+void kexHeap::PoolFree(memBlock_t *block, kexHeapBlock *heapBlock)
+{
+    // clear the tag so stale pointers are caught by GetBlock
+    block->heapTag = 0;
+    block->next = heapBlock->freeBlocks[block->poolClass];
+    heapBlock->freeBlocks[block->poolClass] = block;
+}
+
+//
+// kexHeap::ReleaseSlabs
+//
+
+void kexHeap::ReleaseSlabs(kexHeapBlock *heapBlock)
+{
+    memSlab_t *slab;
+    memSlab_t *next;
+
+    for(slab = heapBlock->slabs; slab != NULL;)
+    {
+        next = slab->next;
+        free(slab);
+        slab = next;
+    }
+
+    heapBlock->slabs = NULL;
+    memset(heapBlock->freeBlocks, 0, sizeof(heapBlock->freeBlocks));
+}
+
 //
 // kexHeap::Malloc
 //
@@ -189,12 +549,18 @@ memBlock_t *kexHeap::GetBlock(void *ptr, const char *file, int line)
 void *kexHeap::Malloc(int size, kexHeapBlock &heapBlock, const char *file, int line)
 {
     memBlock_t *newblock;
+    int poolClass;
 
     assert(size > 0);
 
     newblock = NULL;
+    poolClass = heapBlock.bPooled ? kexHeap::PoolClass(size) : MEM_POOL_NONE;
 
-    if(!(newblock = (memBlock_t*)malloc(sizeof(memBlock_t) + size)))
+    if(poolClass != MEM_POOL_NONE)
+    {
+        newblock = kexHeap::PoolAlloc(&heapBlock, poolClass, file, line);
+    }
+    else if(!(newblock = (memBlock_t*)malloc(sizeof(memBlock_t) + size)))
     {
         kex::cSystem->Error("kexHeap::Malloc: failed on allocation of %u bytes (%s:%d)", size, file, line);
     }
@@ -202,9 +568,11 @@ void *kexHeap::Malloc(int size, kexHeapBlock &heapBlock, const char *file, int l
     newblock->purgeID = heapBlock.purgeID;
     newblock->heapTag = kexHeap::HeapTag;
     newblock->size = size;
+    newblock->poolClass = poolClass;
     newblock->ptrRef = NULL;
 
     kexHeap::AddBlock(newblock, &heapBlock);
+    kexHeap::TrackAlloc(newblock, file, line);
 
     return ((byte*)newblock) + sizeof(memBlock_t);
 }
@@ -243,6 +611,36 @@ void *kexHeap::Realloc(void *ptr, int size, kexHeapBlock &heapBlock, const char
     block = kexHeap::GetBlock(ptr, file, line);
     newblock = NULL;
 
+    if(block->poolClass != MEM_POOL_NONE ||
+       (heapBlock.bPooled && kexHeap::PoolClass(size) != MEM_POOL_NONE))
+    {
+        void *newptr;
+
+        if(block->ptrRef)
+        {
+            *block->ptrRef = NULL;
+            block->ptrRef = NULL;
+        }
+
+        // still fits in the same slot?
+        if(block->heapBlock == &heapBlock && heapBlock.bPooled &&
+           block->poolClass == kexHeap::PoolClass(size))
+        {
+            kexHeap::TrackFree(block);
+            heapBlock.numBytes += size - block->size;
+            block->size = size;
+            kexHeap::TrackAlloc(block, file, line);
+            return ptr;
+        }
+
+        newptr = kexHeap::Malloc(size, heapBlock, file, line);
+        memcpy(newptr, ptr, MIN(size, block->size));
+        kexHeap::Free(ptr, file, line);
+
+        return newptr;
+    }
+
+    kexHeap::TrackFree(block);
     kexHeap::RemoveBlock(block);
 
     block->next = NULL;
@@ -261,20 +659,131 @@ void *kexHeap::Realloc(void *ptr, int size, kexHeapBlock &heapBlock, const char
     newblock->purgeID = heapBlock.purgeID;
     newblock->heapTag = kexHeap::HeapTag;
     newblock->size = size;
+    newblock->poolClass = MEM_POOL_NONE;
     newblock->ptrRef = NULL;
 
     kexHeap::AddBlock(newblock, &heapBlock);
+    kexHeap::TrackAlloc(newblock, file, line);
 
     return ((byte*)newblock) + sizeof(memBlock_t);
 }
 
+//
+// kexHeap::NextArenaChunk
+//
+// Moves on to the next chunk that can hold the allocation,
+// linking in a new one if none of the existing chunks fit
+//
+
+memArenaChunk_t *kexHeap::NextArenaChunk(const int size, const char *file, int line)
+{
+    memArenaChunk_t *chunk;
+
+    chunk = arenaCurrent ? arenaCurrent->next : arenaChunks;
+
+    while(chunk != NULL && chunk->size < size)
+    {
+        chunk = chunk->next;
+    }
+
+    if(chunk == NULL)
+    {
+        int chunkSize = MAX(kexHeap::ArenaChunkSize, size);
+
+        if(!(chunk = (memArenaChunk_t*)malloc(kexHeap::ArenaHeaderSize + chunkSize)))
+        {
+            kex::cSystem->Error("kexHeap::Alloca: failed on allocation of %u bytes (%s:%d)", size, file, line);
+        }
+
+        chunk->size = chunkSize;
+
+        if(arenaCurrent)
+        {
+            chunk->next = arenaCurrent->next;
+            arenaCurrent->next = chunk;
+        }
+        else
+        {
+            chunk->next = arenaChunks;
+            arenaChunks = chunk;
+        }
+    }
+
+    chunk->used = 0;
+    arenaCurrent = chunk;
+
+    return chunk;
+}
+
+//
+// kexHeap::ArenaOwns
+//
+
+bool kexHeap::ArenaOwns(void *ptr)
+{
+    for(memArenaChunk_t *chunk = arenaChunks; chunk; chunk = chunk->next)
+    {
+        byte *data = ((byte*)chunk) + kexHeap::ArenaHeaderSize;
+
+        if((byte*)ptr >= data && (byte*)ptr < data + chunk->size)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
 //
 // kexHeap::Alloca
 //
+// Bumps a pointer through the per-frame arena. The memory
+// stays valid until the end of the frame (Mem_GC)
+//
 
 void *kexHeap::Alloca(int size, const char *file, int line)
 {
-    return size == 0 ? NULL : kexHeap::Calloc(size, hb_auto, file, line);
+    memArenaChunk_t *chunk;
+    byte *data;
+
+    if(size <= 0)
+    {
+        return NULL;
+    }
+
+    size = (size + 15) & ~15;
+    chunk = arenaCurrent;
+
+    if(chunk == NULL || chunk->used + size > chunk->size)
+    {
+        chunk = kexHeap::NextArenaChunk(size, file, line);
+    }
+
+    data = ((byte*)chunk) + kexHeap::ArenaHeaderSize + chunk->used;
+    chunk->used += size;
+
+    arenaUsed += size;
+    if(arenaUsed > arenaPeak)
+    {
+        arenaPeak = arenaUsed;
+    }
+
+    return memset(data, 0, size);
+}
+
+//
+// kexHeap::ResetArena
+//
+
+void kexHeap::ResetArena(void)
+{
+    arenaCurrent = arenaChunks;
+    arenaUsed = 0;
+
+    if(arenaCurrent)
+    {
+        arenaCurrent->used = 0;
+    }
 }
 
 //
@@ -284,6 +793,14 @@ void *kexHeap::Alloca(int size, const char *file, int line)
 void kexHeap::Free(void *ptr, const char *file, int line)
 {
     memBlock_t* block;
+    kexHeapBlock *heapBlock;
+
+    // arena memory is released all at once at the end of the frame. arena
+    // allocations have no header, so check this before reading one
+    if(kexHeap::ArenaOwns(ptr))
+    {
+        return;
+    }
 
     block = kexHeap::GetBlock(ptr, file, line);
     if(block->ptrRef)
@@ -291,8 +808,17 @@ void kexHeap::Free(void *ptr, const char *file, int line)
         *block->ptrRef = NULL;
     }
 
+    heapBlock = block->heapBlock;
+    kexHeap::TrackFree(block);
     kexHeap::RemoveBlock(block);
 
+    if(block->poolClass != MEM_POOL_NONE)
+    {
+        // return to the slab's free list
+        kexHeap::PoolFree(block, heapBlock);
+        return;
+    }
+
     // free back to system
     free(block);
 }
@@ -320,11 +846,21 @@ void kexHeap::Purge(kexHeapBlock &heapBlock, const char *file, int line)
             *block->ptrRef = NULL;
         }
 
-        free(block);
+        kexHeap::TrackFree(block);
+
+        // pooled blocks go away with their slabs
+        if(block->poolClass == MEM_POOL_NONE)
+        {
+            free(block);
+        }
+
         block = next;
     }
 
     heapBlock.blocks = NULL;
+    heapBlock.numBlocks = 0;
+    heapBlock.numBytes = 0;
+    kexHeap::ReleaseSlabs(&heapBlock);
 }
 
 //
@@ -342,6 +878,7 @@ void kexHeap::SetCacheRef(void **ptr, const char *file, int line)
 
 void kexHeap::GarbageCollect(const char *file, int line)
 {
+    kexHeap::ResetArena();
     kexHeap::Purge(hb_auto, file, line);
 }
 
@@ -381,15 +918,7 @@ void kexHeap::CheckBlocks(const char *file, int line)
 
 int kexHeap::Usage(const kexHeapBlock &heapBlock)
 {
-    int bytes = 0;
-    memBlock_t *block;
-
-    for(block = heapBlock.blocks; block != NULL; block = block->next)
-    {
-        bytes += block->size;
-    }
-
-    return bytes;
+    return heapBlock.numBytes;
 }
 
 //
@@ -401,7 +930,6 @@ int kexHeap::Usage(const kexHeapBlock &heapBlock)
 
 void kexHeap::DrawHeapInfo(void)
 {
-    memBlock_t *block;
     int numBlocks;
     unsigned int c;
     byte *cb;
@@ -426,17 +954,28 @@ void kexHeap::DrawHeapInfo(void)
         PRINT_HEAP(kexStr::Format(": %ikb", kexHeap::Usage(*heapBlock) >> 10), 128, y, 1, false, cb, cb);
         PRINT_HEAP(kexStr::Format(" allocated: %i", heapBlock->numAllocated), 192, y, 1, false, cb, cb);
 
-        numBlocks = 0;
-        for(block = heapBlock->blocks; block != NULL; block = block->next)
-        {
-            numBlocks++;
-        }
+        numBlocks = heapBlock->numBlocks;
 
         PRINT_HEAP(kexStr::Format(" freed: %i", heapBlock->numAllocated - numBlocks), 320, y, 1, false, cb, cb);
 
         heapBlock->numAllocated = numBlocks;
         y += 16;
     }
+
+    numBlocks = 0;
+    for(memArenaChunk_t *chunk = arenaChunks; chunk; chunk = chunk->next)
+    {
+        numBlocks++;
+    }
+
+    c = RGBA(0, 255, 0, 255);
+    PRINT_HEAP("alloca", 32, y, 1, false, cb, cb);
+
+    c = RGBA(255, 255, 0, 255);
+    PRINT_HEAP(kexStr::Format(": %ikb", arenaUsed >> 10), 128, y, 1, false, cb, cb);
+    PRINT_HEAP(kexStr::Format(" peak: %ikb", arenaPeak >> 10), 192, y, 1, false, cb, cb);
+    PRINT_HEAP(kexStr::Format(" chunks: %i", numBlocks), 320, y, 1, false, cb, cb);
+    y += 16;
     
     kexRender::cUtils->debugLineNum = y;
     kexRender::cUtils->AddDebugLineSpacing();
@@ -19,17 +19,48 @@ typedef void (*blockFunc_t)(void*);
 
 class kexHeapBlock;
 
+// small allocations are carved out of slabs, one free list per size class
+// (16, 32, 64 ... 1024 bytes)
+#define MEM_POOL_CLASSES    7
+#define MEM_POOL_NONE       -1
+
 typedef struct memBlock_s
 {
     int                     heapTag;
     int                     purgeID;
     int                     size;
+    short                   poolClass;
+    short                   callSite;
     kexHeapBlock            *heapBlock;
     void                    **ptrRef;
     struct memBlock_s       *prev;
     struct memBlock_s       *next;
 } memBlock_t;
 
+typedef struct memSlab_s
+{
+    struct memSlab_s        *next;
+    int                     poolClass;
+} memSlab_t;
+
+typedef struct memArenaChunk_s
+{
+    struct memArenaChunk_s  *next;
+    int                     size;
+    int                     used;
+} memArenaChunk_t;
+
+typedef struct
+{
+    const char              *file;
+    int                     line;
+    int                     count;
+    int                     numBlocks;
+    int                     bytes;
+    int                     peakBytes;
+    uint64_t                totalBytes;
+} memCallSite_t;
+
 class kexHeapBlock
 {
 public:
@@ -46,6 +77,11 @@ public:
     blockFunc_t             gcFunc;
     int                     purgeID;
     int                     numAllocated;
+    int                     numBlocks;
+    int                     numBytes;
+    bool                    bPooled;
+    memSlab_t               *slabs;
+    memBlock_t              *freeBlocks[MEM_POOL_CLASSES];
     kexHeapBlock            *prev;
     kexHeapBlock            *next;
 };
@@ -64,6 +100,8 @@ public:
     static int              Usage(const kexHeapBlock &heapBlock);
     static void             SetCacheRef(void **ptr, const char *file, int line);
     static void             DrawHeapInfo(void);
+    static void             ResetArena(void);
+    static bool             DumpCallSites(const char *file);
 
     static int              numHeapBlocks;
     static kexHeapBlock     *currentHeapBlock;
@@ -71,12 +109,41 @@ public:
     static kexHeapBlock     *blockList;
     static bool             bDrawHeapInfo;
 
+    static memArenaChunk_t  *arenaChunks;
+    static memArenaChunk_t  *arenaCurrent;
+    static int              arenaUsed;
+    static int              arenaPeak;
+
+    static bool             bTrackCallSites;
+    static memCallSite_t    callSites[];
+    static int              numCallSites;
+
 private:
     static void             AddBlock(memBlock_t *block, kexHeapBlock *heapBlock);
     static void             RemoveBlock(memBlock_t *block);
     static memBlock_t       *GetBlock(void *ptr, const char *file, int line);
+    static int              PoolClass(const int size);
+    static memBlock_t       *PoolAlloc(kexHeapBlock *heapBlock, const int poolClass,
+                                       const char *file, int line);
+    static void             PoolFree(memBlock_t *block, kexHeapBlock *heapBlock);
+    static void             ReleaseSlabs(kexHeapBlock *heapBlock);
+    static memArenaChunk_t  *NextArenaChunk(const int size, const char *file, int line);
+    static bool             ArenaOwns(void *ptr);
+    static void             TrackAlloc(memBlock_t *block, const char *file, int line);
+    static void             TrackFree(memBlock_t *block);
 
     static const int        HeapTag = 0x03151983;
+    static const int        PoolMinSize = 16;
+    static const int        PoolMaxSize = (PoolMinSize << (MEM_POOL_CLASSES-1));
+    static const int        SlabSize = 32768;
+    static const int        ArenaChunkSize = 65536;
+    // large enough that reading a block header in front of any
+    // arena pointer stays inside the chunk
+    static const int        ArenaHeaderSize = (sizeof(memBlock_t) + 15) & ~15;
+    static const int        MaxCallSites = 4096;
+    static const int        CallSiteHashSize = 8192;
+
+    static short            callSiteHash[];
 };
 
 extern kexHeapBlock hb_static;
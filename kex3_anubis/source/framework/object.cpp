@@ -22,14 +22,23 @@
 // kexRTTI::kexRTTI
 //
 
-kexRTTI::kexRTTI(const char *classname, const char *supername,
+kexRTTI::kexRTTI(const char *classname, const char *supername, const int objectSize,
                  kexObject *(*Create)(void), void(kexObject::*Spawn)(void))
 {
     this->classname     = classname;
     this->supername     = supername;
+    this->objectSize    = objectSize;
     this->Create        = Create;
     this->Spawn         = Spawn;
+    this->freeObjects   = NULL;
+    this->numFreeObjects= 0;
+    this->poolHits      = 0;
+    this->poolMisses    = 0;
     this->type_id       = ++kexObject::roverID;
+    this->classIndex    = 0;
+    this->lastDescendant= 0;
+    this->firstChild    = NULL;
+    this->nextSibling   = NULL;
     this->super         = kexObject::Get(supername);
 
     // link all classes with supers to this class if not referenced yet
@@ -77,6 +86,9 @@ void kexRTTI::Init(void)
 
 void kexRTTI::Destroy(void)
 {
+    // pooled memory belongs to hb_object and goes away with it
+    freeObjects = NULL;
+    numFreeObjects = 0;
 }
 
 //
@@ -88,11 +100,73 @@ bool kexRTTI::InstanceOf(const kexRTTI *objInfo) const
     return type_id == objInfo->type_id;
 }
 
+//
+// kexRTTI::AllocObject
+//
+// Returns zeroed memory for a new instance of this class,
+// recycling a previously deleted instance when possible
+//
+
+void *kexRTTI::AllocObject(void)
+{
+    byte *data;
+
+    if(freeObjects)
+    {
+        data = (byte*)freeObjects;
+        freeObjects = *(void**)data;
+        numFreeObjects--;
+        poolHits++;
+
+        return memset(data, 0, objectSize);
+    }
+
+    poolMisses++;
+
+    data = (byte*)Mem_Calloc(kexObject::HeaderSize + objectSize, hb_object);
+    *(kexRTTI**)data = this;
+
+    return data + kexObject::HeaderSize;
+}
+
+//
+// kexRTTI::FreeObject
+//
+
+void kexRTTI::FreeObject(void *ptr)
+{
+    *(void**)ptr = freeObjects;
+    freeObjects = ptr;
+    numFreeObjects++;
+}
+
+//
+// kexRTTI::Reserve
+//
+// Makes sure at least count instances can be
+// created without going through the heap
+//
+
+void kexRTTI::Reserve(const int count)
+{
+    byte *data;
+
+    while(numFreeObjects < count)
+    {
+        data = (byte*)Mem_Malloc(kexObject::HeaderSize + objectSize, hb_object);
+        *(kexRTTI**)data = this;
+
+        FreeObject(data + kexObject::HeaderSize);
+    }
+}
+
 DECLARE_ABSTRACT_KEX_CLASS(kexObject, NULL)
 
 kexRTTI *kexObject::root = NULL;
 bool kexObject::bInitialized = false;
 int kexObject::roverID = 0;
+kexRTTI **kexObject::classTable = NULL;
+unsigned int kexObject::classMask = 0;
 
 //
 // kexObject::~kexObject
@@ -129,8 +203,11 @@ void kexObject::Init(void)
         oi->Init();
     }
 
+    BuildClassIndex();
+
     bInitialized = true;
     kex::cCommands->Add("listRuntimeClasses", kexObject::ListClasses);
+    kex::cCommands->Add("listObjectPools", kexObject::ListPools);
     kex::cSystem->Printf("Runtime Object Initialized\n");
 }
 
@@ -145,9 +222,117 @@ void kexObject::Shutdown(void)
         oi->Destroy();
     }
 
+    if(classTable)
+    {
+        Mem_Free(classTable);
+        classTable = NULL;
+        classMask = 0;
+    }
+
     bInitialized = false;
 }
 
+//
+// kexObject::NumberClasses
+//
+// Hands out class indices in preorder so that every subclass of a
+// class falls within [classIndex, lastDescendant]
+//
+
+int kexObject::NumberClasses(kexRTTI *rtti, int index)
+{
+    rtti->classIndex = index++;
+
+    for(kexRTTI *child = rtti->firstChild; child != NULL; child = child->nextSibling)
+    {
+        index = NumberClasses(child, index);
+    }
+
+    rtti->lastDescendant = index - 1;
+    return index;
+}
+
+//
+// kexObject::HashClassName
+//
+
+unsigned int kexObject::HashClassName(const char *classname)
+{
+    unsigned int hash = 0;
+    char c;
+
+    while((c = *classname++))
+    {
+        hash = c + (hash << 6) + (hash << 16) - hash;
+    }
+
+    return hash;
+}
+
+//
+// kexObject::BuildClassIndex
+//
+// Builds the class hierarchy out of the super links, numbers it for
+// InstanceOf and fills the hash table used to look up classes by name
+//
+
+void kexObject::BuildClassIndex(void)
+{
+    kexRTTI *oi;
+    int numClasses = 0;
+    int index = 1;
+    unsigned int size = 16;
+
+    for(oi = kexObject::root; oi != NULL; oi = oi->next)
+    {
+        oi->firstChild = NULL;
+        oi->nextSibling = NULL;
+        numClasses++;
+    }
+
+    for(oi = kexObject::root; oi != NULL; oi = oi->next)
+    {
+        if(oi->super)
+        {
+            oi->nextSibling = oi->super->firstChild;
+            oi->super->firstChild = oi;
+        }
+    }
+
+    for(oi = kexObject::root; oi != NULL; oi = oi->next)
+    {
+        if(oi->super == NULL)
+        {
+            index = NumberClasses(oi, index);
+        }
+    }
+
+    while(size < (unsigned int)numClasses * 2)
+    {
+        size <<= 1;
+    }
+
+    if(classTable)
+    {
+        Mem_Free(classTable);
+    }
+
+    classTable = (kexRTTI**)Mem_Calloc(sizeof(kexRTTI*) * size, hb_static);
+    classMask = size - 1;
+
+    for(oi = kexObject::root; oi != NULL; oi = oi->next)
+    {
+        unsigned int i = HashClassName(oi->classname) & classMask;
+
+        while(classTable[i] != NULL)
+        {
+            i = (i + 1) & classMask;
+        }
+
+        classTable[i] = oi;
+    }
+}
+
 //
 // kexObject::ExecSpawnFunction
 //
@@ -193,7 +378,8 @@ void kexObject::Spawn(void)
 
 void *kexObject::operator new(size_t s)
 {
-    return Mem_Calloc(s, hb_object);
+    byte *data = (byte*)Mem_Calloc(kexObject::HeaderSize + s, hb_object);
+    return data + kexObject::HeaderSize;
 }
 
 //
@@ -202,7 +388,16 @@ void *kexObject::operator new(size_t s)
 
 void kexObject::operator delete(void *ptr)
 {
-    Mem_Free(ptr);
+    byte *data = (byte*)ptr - kexObject::HeaderSize;
+    kexRTTI *pool = *(kexRTTI**)data;
+
+    if(pool)
+    {
+        pool->FreeObject(ptr);
+        return;
+    }
+
+    Mem_Free(data);
 }
 
 //
@@ -216,6 +411,20 @@ kexRTTI *kexObject::Get(const char *classname)
         return NULL;
     }
 
+    if(classTable)
+    {
+        for(unsigned int i = HashClassName(classname) & classMask; classTable[i]; i = (i + 1) & classMask)
+        {
+            if(!strcmp(classTable[i]->classname, classname))
+            {
+                return classTable[i];
+            }
+        }
+
+        return NULL;
+    }
+
+    // static constructors run before the index is built
     for(kexRTTI *oi = kexObject::root; oi != NULL; oi = oi->next)
     {
         if(!strcmp(oi->classname, classname))
@@ -232,6 +441,12 @@ kexRTTI *kexObject::Get(const char *classname)
 
 bool kexObject::InstanceOf(const kexRTTI *objInfo) const
 {
+    if(bInitialized)
+    {
+        const int index = GetInfo()->classIndex;
+        return index >= objInfo->classIndex && index <= objInfo->lastDescendant;
+    }
+
     for(const kexRTTI *oi = GetInfo(); oi; oi = oi->super)
     {
         if(oi->type_id == objInfo->type_id)
@@ -304,7 +519,29 @@ void kexObject::ListClasses(void)
     kex::cSystem->CPrintf(COLOR_GREEN, "-------------- Runtime Classes ---------------\n");
     for(kexRTTI *oi= kexObject::root; oi != NULL; oi = oi->next)
     {
-        kex::cSystem->Printf("%s %s %i\n", oi->classname, oi->supername, oi->type_id);
+        kex::cSystem->Printf("%s %s %i [%i-%i]\n", oi->classname, oi->supername, oi->type_id,
+                             oi->classIndex, oi->lastDescendant);
+    }
+    kex::cSystem->CPrintf(COLOR_GREEN, "----------------------------------------------\n\n");
+}
+
+//
+// kexObject::ListPools
+//
+
+void kexObject::ListPools(void)
+{
+    kex::cSystem->CPrintf(COLOR_GREEN, "---------------- Object Pools ----------------\n");
+    for(kexRTTI *oi= kexObject::root; oi != NULL; oi = oi->next)
+    {
+        if(oi->poolHits == 0 && oi->poolMisses == 0 && oi->numFreeObjects == 0)
+        {
+            continue;
+        }
+
+        kex::cSystem->Printf("%s: size %i free %i hits %i misses %i\n",
+                             oi->classname, oi->objectSize, oi->numFreeObjects,
+                             oi->poolHits, oi->poolMisses);
     }
     kex::cSystem->CPrintf(COLOR_GREEN, "----------------------------------------------\n\n");
 }
@@ -33,6 +33,7 @@ public:                                                 \
 
 #define DEFINE_KEX_CLASS(classname, supername)                  \
     kexRTTI classname::info(#classname, #supername,             \
+        sizeof(classname),                                      \
         classname::Create,                                      \
         (void(kexObject::*)(void))&classname::Spawn);           \
     kexRTTI *classname::GetInfo(void) const {                   \
@@ -42,7 +43,7 @@ public:                                                 \
 #define DECLARE_KEX_CLASS(classname, supername)             \
     DEFINE_KEX_CLASS(classname, supername)                  \
     kexObject *classname::Create(void) {                    \
-        return new classname;                               \
+        return ::new(classname::info.AllocObject()) classname;  \
     }
 
 #define DECLARE_ABSTRACT_KEX_CLASS(classname, supername)    \
@@ -60,7 +61,7 @@ typedef void(kexObject::*spawnObjFunc_t)(void);
 class kexRTTI
 {
 public:
-    kexRTTI(const char *classname, const char *supername,
+    kexRTTI(const char *classname, const char *supername, const int objectSize,
             kexObject *(*Create)(void),
             void(kexObject::*Spawn)(void));
     ~kexRTTI(void);
@@ -68,14 +69,26 @@ public:
     void                    Init(void);
     void                    Destroy(void);
     bool                    InstanceOf(const kexRTTI *objInfo) const;
+    void                    *AllocObject(void);
+    void                    FreeObject(void *ptr);
+    void                    Reserve(const int count);
     kexObject               *(*Create)(void);
     void                    (kexObject::*Spawn)(void);
 
     int                     type_id;
+    int                     classIndex;
+    int                     lastDescendant;
+    int                     objectSize;
+    void                    *freeObjects;
+    int                     numFreeObjects;
+    int                     poolHits;
+    int                     poolMisses;
     const char              *classname;
     const char              *supername;
     kexRTTI                 *next;
     kexRTTI                 *super;
+    kexRTTI                 *firstChild;
+    kexRTTI                 *nextSibling;
 };
 
 BEGIN_KEX_CLASS(kexObject);
@@ -99,13 +112,24 @@ BEGIN_KEX_CLASS(kexObject);
     static kexRTTI          *Get(const char *classname);
     static kexObject        *Create(const char *name);
     static void             ListClasses(void);
+    static void             ListPools(void);
 
     static int              roverID;
     static kexRTTI          *root;
 
+    // every allocation is prefixed with the kexRTTI of the pool
+    // it came from, or NULL if it came straight from the heap
+    static const int        HeaderSize = 16;
+
     private:
+    static int              NumberClasses(kexRTTI *rtti, int index);
+    static void             BuildClassIndex(void);
+    static unsigned int     HashClassName(const char *classname);
+
     static bool             bInitialized;
     static int              numObjects;
+    static kexRTTI          **classTable;
+    static unsigned int     classMask;
 END_KEX_CLASS();
 
 #endif
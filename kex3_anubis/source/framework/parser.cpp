@@ -1072,6 +1072,18 @@ kexLexer *kexParser::Open(const char* filename)
 
     buffsize = kex::cPakFiles->OpenFile(filename, (byte**)(&buffer), hb_static);
 
+    return Open(filename, (char*)buffer, buffsize);
+}
+
+//
+// kexParser::Open
+//
+// Same as above but for a file that has already been read in.
+// The lexer takes ownership of the buffer
+//
+
+kexLexer *kexParser::Open(const char *filename, char *buffer, const int buffsize)
+{
     if(buffsize <= 0)
     {
         kex::cSystem->Warning("kexParser::Open: %s not found\n", filename);
@@ -1079,7 +1091,7 @@ kexLexer *kexParser::Open(const char* filename)
     }
 
     // push out a new lexer
-    PushLexer(filename, (char*)buffer, buffsize);
+    PushLexer(filename, buffer, buffsize);
     PushFileName(filename);
 
     return currentLexer;
@@ -137,6 +137,7 @@ public:
     ~kexParser(void);
 
     kexLexer            *Open(const char *filename);
+    kexLexer            *Open(const char *filename, char *buffer, const int buffsize);
     void                Close(void);
     void                Error(const char *msg, ...);
     void                PushLexer(const char *filename, char *buf, int bufSize);
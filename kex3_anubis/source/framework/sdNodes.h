@@ -78,14 +78,30 @@ public:
     void                BuildNodes(void);
     int                 PointInNode(const kexVec3 &point, const float min = 0);
 
+    // queries are done in 2D against the boxes the objects were linked
+    // with. up to maxCount objects are written to list and the total
+    // number of hits is returned. objects must provide AreaLink()
+    unsigned int        QueryBox(const kexBBox &box, type **list, const unsigned int maxCount);
+    unsigned int        QueryRadius(const kexVec3 &origin, const float radius,
+                                    type **list, const unsigned int maxCount);
+    unsigned int        QueryRay(const kexVec3 &start, const kexVec3 &end, const float radius,
+                                 type **list, const unsigned int maxCount);
+
     kexSDNodeObj<type>  *nodes;
     unsigned int        numNodes;
 
 private:
+    typedef bool        (*queryTest_t)(const kexBBox &box, const float *params);
+
     kexSDNodeObj<type>  *AddNode(int depth, kexBBox &box);
+    unsigned int        Query(const kexBBox &box, queryTest_t test, const float *params,
+                              type **list, const unsigned int maxCount);
+    static bool         TestRadius(const kexBBox &box, const float *params);
+    static bool         TestRay(const kexBBox &box, const float *params);
 
     unsigned int        maxDepth;
     unsigned int        maxNodes;
+    kexSDNodeObj<type>  **queryStack;
     kexVec3             rootBoundMin;
     kexVec3             rootBoundMax;
 };
@@ -104,6 +120,7 @@ kexSDNode<type>::kexSDNode(void)
     rootBoundMin[2] =  kexMath::infinity;
 
     nodes = NULL;
+    queryStack = NULL;
     numNodes = 0;
     maxDepth = 8;
     maxNodes = 512;
@@ -129,6 +146,10 @@ void kexSDNode<type>::Init(const unsigned int depth)
     numNodes = 0;
 
     nodes = new kexSDNodeObj<type>[maxNodes];
+
+    // a query holds at most one deferred sibling per level
+    // below the node it is currently visiting
+    queryStack = new kexSDNodeObj<type>*[maxDepth + 2];
     Reset();
 }
 
@@ -143,6 +164,12 @@ void kexSDNode<type>::Destroy(void)
         delete[] nodes;
         nodes = NULL;
     }
+
+    if(queryStack != NULL)
+    {
+        delete[] queryStack;
+        queryStack = NULL;
+    }
 }
 
 //
@@ -284,6 +311,194 @@ int kexSDNode<type>::PointInNode(const kexVec3 &point, const float min)
     return n->nodeNum;
 }
 
+//
+// kexSDNode::Query
+//
+// Walks every node whose side of the splits overlaps the
+// box and tests all objects linked to them
+//
+template<class type>
+unsigned int kexSDNode<type>::Query(const kexBBox &box, queryTest_t test, const float *params,
+                                    type **list, const unsigned int maxCount)
+{
+    kexSDNodeObj<type> **stack = queryStack;
+    unsigned int sp = 0;
+    unsigned int count = 0;
+
+    if(nodes == NULL || numNodes == 0)
+    {
+        return 0;
+    }
+
+    stack[sp++] = nodes;
+
+    while(sp > 0)
+    {
+        kexSDNodeObj<type> *n = stack[--sp];
+
+        for(type *obj = n->objects.Next(); obj != NULL; obj = obj->AreaLink().link.Next())
+        {
+            const kexBBox &objBox = obj->AreaLink().box;
+
+            if(objBox.min.x > box.max.x || objBox.max.x < box.min.x ||
+               objBox.min.y > box.max.y || objBox.max.y < box.min.y)
+            {
+                continue;
+            }
+
+            if(test && !test(objBox, params))
+            {
+                continue;
+            }
+
+            if(count < maxCount)
+            {
+                list[count] = obj;
+            }
+
+            count++;
+        }
+
+        if(n->axis == -1)
+        {
+            continue;
+        }
+
+        if(box.max[n->axis] > n->dist)
+        {
+            stack[sp++] = n->children[0];
+        }
+
+        if(box.min[n->axis] < n->dist)
+        {
+            stack[sp++] = n->children[1];
+        }
+    }
+
+    return count;
+}
+
+//
+// kexSDNode::TestRadius
+//
+template<class type>
+bool kexSDNode<type>::TestRadius(const kexBBox &box, const float *params)
+{
+    float x = params[0];
+    float y = params[1];
+
+    // closest point on the box
+    if(x < box.min.x) x = box.min.x; else if(x > box.max.x) x = box.max.x;
+    if(y < box.min.y) y = box.min.y; else if(y > box.max.y) y = box.max.y;
+
+    x -= params[0];
+    y -= params[1];
+
+    return (x * x + y * y) <= (params[2] * params[2]);
+}
+
+//
+// kexSDNode::TestRay
+//
+// Slab test of the segment against the box grown by the radius
+//
+template<class type>
+bool kexSDNode<type>::TestRay(const kexBBox &box, const float *params)
+{
+    float tmin = 0;
+    float tmax = 1;
+
+    for(int i = 0; i < 2; ++i)
+    {
+        const float start = params[i];
+        const float delta = params[2+i];
+        const float bmin = box.min[i] - params[4];
+        const float bmax = box.max[i] + params[4];
+
+        if(kexMath::Fabs(delta) < 0.0001f)
+        {
+            if(start < bmin || start > bmax)
+            {
+                return false;
+            }
+
+            continue;
+        }
+
+        float t1 = (bmin - start) / delta;
+        float t2 = (bmax - start) / delta;
+
+        if(t1 > t2)
+        {
+            float t = t1; t1 = t2; t2 = t;
+        }
+
+        if(t1 > tmin) tmin = t1;
+        if(t2 < tmax) tmax = t2;
+
+        if(tmin > tmax)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//
+// kexSDNode::QueryBox
+//
+template<class type>
+unsigned int kexSDNode<type>::QueryBox(const kexBBox &box, type **list, const unsigned int maxCount)
+{
+    return Query(box, NULL, NULL, list, maxCount);
+}
+
+//
+// kexSDNode::QueryRadius
+//
+template<class type>
+unsigned int kexSDNode<type>::QueryRadius(const kexVec3 &origin, const float radius,
+                                          type **list, const unsigned int maxCount)
+{
+    kexBBox box;
+    float params[3];
+
+    box.min.Set(origin.x - radius, origin.y - radius, 0);
+    box.max.Set(origin.x + radius, origin.y + radius, 0);
+
+    params[0] = origin.x;
+    params[1] = origin.y;
+    params[2] = radius;
+
+    return Query(box, TestRadius, params, list, maxCount);
+}
+
+//
+// kexSDNode::QueryRay
+//
+template<class type>
+unsigned int kexSDNode<type>::QueryRay(const kexVec3 &start, const kexVec3 &end, const float radius,
+                                       type **list, const unsigned int maxCount)
+{
+    kexBBox box;
+    float params[5];
+
+    box.Clear();
+    box.AddPoint(kexVec3(start.x, start.y, 0));
+    box.AddPoint(kexVec3(end.x, end.y, 0));
+    box.min.x -= radius; box.min.y -= radius;
+    box.max.x += radius; box.max.y += radius;
+
+    params[0] = start.x;
+    params[1] = start.y;
+    params[2] = end.x - start.x;
+    params[3] = end.y - start.y;
+    params[4] = radius;
+
+    return Query(box, TestRay, params, list, maxCount);
+}
+
 //-----------------------------------------------------------------------------
 //
 // node reference
@@ -300,6 +515,7 @@ public:
 
     kexLinklist<type>   link;
     kexSDNodeObj<type>  *node;
+    kexBBox             box;
 };
 
 //
@@ -334,6 +550,7 @@ void kexSDNodeRef<type>::Link(kexSDNode<type> &sdNode, kexBBox &box)
 
     link.AddBefore(n->objects);
     node = n;
+    this->box = box;
 }
 
 //
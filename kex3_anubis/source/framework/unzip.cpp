@@ -2167,6 +2167,72 @@ extern int unzGetLocalExtrafield (unzFile file,void *buf,unsigned len)
 	return (int)read_now;
 }
 
+/*
+  Get the absolute position of the local header of the current file
+*/
+extern int unzGetCurrentFileLocalOffset (unzFile file, unsigned long *pos)
+{
+	unz_s* s;
+
+	if (file==NULL)
+		return UNZ_PARAMERROR;
+	s=(unz_s*)file;
+
+	if (!s->current_file_ok)
+		return UNZ_END_OF_LIST_OF_FILE;
+
+	*pos = s->cur_file_info_internal.offset_curfile + s->byte_before_the_zipfile;
+	return UNZ_OK;
+}
+
+/*
+  Inflate state is allocated with malloc rather than the engine heap so
+  that unzInflateBuffer can be called from worker threads
+*/
+static voidp unzInflateAlloc (voidp opaque, unsigned items, unsigned size)
+{
+	return (voidp)malloc(items*size);
+}
+
+static void unzInflateFree (voidp opaque, voidp ptr)
+{
+	free(ptr);
+}
+
+/*
+  Inflate a raw deflate stream that is already in memory
+*/
+extern int unzInflateBuffer (const void *src, unsigned long srcLen, void *dst, unsigned long dstLen)
+{
+	z_stream stream;
+	int err;
+
+	memset(&stream, 0, sizeof(stream));
+	stream.zalloc = (alloc_func)unzInflateAlloc;
+	stream.zfree = (free_func)unzInflateFree;
+	stream.next_in = (Byte*)src;
+	stream.avail_in = (uInt)srcLen;
+	stream.next_out = (Byte*)dst;
+	stream.avail_out = (uInt)dstLen;
+
+	if (inflateInit2(&stream, -MAX_WBITS) != Z_OK)
+		return UNZ_INTERNALERROR;
+
+	/* the stream has no trailing dummy byte, so stop once all of the
+	   output has been produced instead of waiting for Z_STREAM_END */
+	do
+	{
+		err = inflate(&stream, Z_SYNC_FLUSH);
+	} while (err == Z_OK && stream.total_out < dstLen);
+
+	inflateEnd(&stream);
+
+	if (stream.total_out != dstLen)
+		return UNZ_BADZIPFILE;
+
+	return UNZ_OK;
+}
+
 /*
   Close the file in zip opened with unzipOpenCurrentFile
   Return UNZ_CRCERROR if all the file was read but the CRC is not good
@@ -316,4 +316,20 @@ extern int unzGetLocalExtrafield (unzFile file, void* buf, unsigned len);
 	the error code
 */
 
+extern int unzGetCurrentFileLocalOffset (unzFile file, unsigned long *pos);
+
+/*
+  Get the absolute position of the local header of the current file
+  inside the zipfile, so the entry can be read straight out of memory
+*/
+
+extern int unzInflateBuffer (const void *src, unsigned long srcLen, void *dst, unsigned long dstLen);
+
+/*
+  Inflate a raw deflate stream (as stored in the zipfile) that lives in
+  memory. dstLen must be the exact uncompressed size. Does not touch the
+  engine heap, so it is safe to call from any thread.
+  return UNZ_OK if there is no problem
+*/
+
 #endif
\ No newline at end of file
@@ -395,6 +395,23 @@ void kexActor::ChangeAnim(const kexStr &str)
     ChangeAnim(sprAnim);
 }
 
+//
+// kexActor::ChangeAnim
+//
+
+void kexActor::ChangeAnim(const kexAtom &atom)
+{
+    spriteAnim_t *sprAnim = kexGame::cLocal->SpriteAnimManager()->Get(atom);
+    
+    if(sprAnim == NULL)
+    {
+        kex::cSystem->Warning("kexActor::ChangeAnim - %s not found\n", atom.c_str());
+        return;
+    }
+    
+    ChangeAnim(sprAnim);
+}
+
 //
 // kexActor::UpdateSprite
 //
@@ -639,9 +656,9 @@ void kexActor::CheckFloorAndCeilings(void)
             velocity.x *= friction;
             velocity.y *= friction;
             
-            if(bounceSounds[r].Length() > 0)
+            if(!bounceSounds[r].IsEmpty())
             {
-                PlaySound(bounceSounds[r].c_str());
+                PlaySound(bounceSounds[r]);
             }
         }
         else
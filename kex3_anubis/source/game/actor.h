@@ -89,6 +89,7 @@ public:
     void                            ChangeAnim(spriteAnim_t *changeAnim);
     void                            ChangeAnim(const char *animName);
     void                            ChangeAnim(const kexStr &str);
+    void                            ChangeAnim(const kexAtom &atom);
     void                            LinkSector(void);
     void                            UnlinkSector(void);
     void                            InflictDamage(kexActor *inflictor, const int amount);
@@ -176,7 +177,7 @@ protected:
     float                           floorOffset;
     float                           floorHeight;
     float                           ceilingHeight;
-    kexStr                          bounceSounds[3];
+    kexAtom                         bounceSounds[3];
     kexActor                        *taggedActor;
     kexVec3                         color;
     byte                            transparency;
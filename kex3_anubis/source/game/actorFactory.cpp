@@ -84,16 +84,34 @@ kexActor *kexActorFactory::Spawn(const int type, const float x, const float y, c
     kexDict *def;
     kexActor *actor;
     
-    if((def = kexGame::cLocal->ActorDefs().GetEntry(type)))
+    if(!ClassNameForType(type, className, &def))
     {
-        if(!def->GetString("classname", className))
+        return NULL;
+    }
+    
+    actor = Construct(className, def, type, x, y, z, yaw, sector);
+    return actor;
+}
+
+//
+// kexActorFactory::ClassNameForType
+//
+// Resolves the class that an actor type spawns as. Returns
+// false if the actor type shouldn't be spawned at all
+//
+
+bool kexActorFactory::ClassNameForType(const int type, kexStr &className, kexDict **def)
+{
+    if((*def = kexGame::cLocal->ActorDefs().GetEntry(type)))
+    {
+        if(!(*def)->GetString("classname", className))
         {
             className = "kexActor";
         }
 
         if(kexGame::cLocal->NoMonstersEnabled() && className == "kexAI")
         {
-            return NULL;
+            return false;
         }
     }
     else
@@ -114,9 +132,49 @@ kexActor *kexActorFactory::Spawn(const int type, const float x, const float y, c
             break;
         }
     }
-    
-    actor = Construct(className, def, type, x, y, z, yaw, sector);
-    return actor;
+
+    return true;
+}
+
+//
+// kexActorFactory::ReserveObjects
+//
+// Pre-warms the object pools with enough instances of each
+// class to spawn all of the map's actors
+//
+
+void kexActorFactory::ReserveObjects(const mapActor_t *mapActors, const unsigned int count)
+{
+    int *counts = (int*)Mem_Alloca(sizeof(int) * (kexObject::roverID + 1));
+    kexStr className;
+    kexDict *def;
+    kexRTTI *objType;
+
+    for(unsigned int i = 0; i < count; ++i)
+    {
+        if(mapActors[i].sector < 0 || mapActors[i].type <= -1)
+        {
+            continue;
+        }
+
+        if(!ClassNameForType(mapActors[i].type, className, &def))
+        {
+            continue;
+        }
+
+        if((objType = kexObject::Get(className)))
+        {
+            counts[objType->type_id]++;
+        }
+    }
+
+    for(objType = kexObject::root; objType != NULL; objType = objType->next)
+    {
+        if(counts[objType->type_id] > 0)
+        {
+            objType->Reserve(counts[objType->type_id]);
+        }
+    }
 }
 
 //
@@ -208,7 +266,8 @@ kexActor *kexActorFactory::SpawnFromActor(const char *name, const float x, const
         actor->Origin().y = source->Origin().y;
         actor->SetSector(source->Sector());
     }
-    
+
+    actor->LinkArea();
     return actor;
 }
 
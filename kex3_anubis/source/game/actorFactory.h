@@ -36,8 +36,10 @@ public:
                                                 kexActor *source, const float yaw);
     kexMover*                   SpawnMover(const char *className, const int type, const int sector);
     kexFireballFactory          *SpawnFireballFactory(mapActor_t *mapActor);
+    void                        ReserveObjects(const mapActor_t *mapActors, const unsigned int count);
     
 private:
+    bool                        ClassNameForType(const int type, kexStr &className, kexDict **def);
 };
 
 #endif
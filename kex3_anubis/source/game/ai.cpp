@@ -323,6 +323,13 @@ bool kexAI::CanSeeTarget(kexActor *actor)
 {
     kexVec3 start = origin + kexVec3(0, 0, height * 0.5f);
     kexVec3 end = actor->Origin() + kexVec3(0, 0, actor->Height() * 0.5f);
+    kexWorld *world = kexGame::cWorld;
+
+    if(sector && actor->Sector() &&
+       !world->SectorPotentiallyVisible(sector - world->Sectors(), actor->Sector() - world->Sectors()))
+    {
+        return false;
+    }
     
     return !kexGame::cLocal->CModel()->Trace(this, sector, start, end, 0, false);
 }
@@ -423,7 +430,7 @@ void kexAI::StartPain(void)
         state = AIS_PAIN;
     }
 
-    if(painSound.Length() > 0)
+    if(!painSound.IsEmpty())
     {
         PlaySound(painSound);
     }
@@ -486,7 +493,7 @@ void kexAI::LookForTarget(void)
     
     if(CheckTargetSight(targ))
     {
-        if(sightSound.Length() > 0)
+        if(!sightSound.IsEmpty())
         {
             PlaySound(sightSound);
         }
@@ -1112,6 +1119,7 @@ void kexAI::UpdateMovement(void)
 
                 igniteFlames[i]->Origin() += movement;
                 igniteFlames[i]->SetSector(sector);
+                igniteFlames[i]->LinkArea();
             }
         }
 
@@ -117,8 +117,8 @@ private:
     spriteAnim_t                    *painAnim;
     spriteAnim_t                    *meleeAnim;
     spriteAnim_t                    *attackAnim;
-    kexStr                          painSound;
-    kexStr                          sightSound;
+    kexAtom                         painSound;
+    kexAtom                         sightSound;
     aiState_t                       state;
     unsigned int                    aiFlags;
     float                           thinkTime;
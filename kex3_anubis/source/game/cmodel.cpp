@@ -20,8 +20,6 @@
 
 #define CONTACT_COUNT   5
 
-int kexCModel::validcount = 1;
-
 //
 // kexCModel::kexCModel
 //
@@ -46,10 +44,14 @@ kexCModel::~kexCModel(void)
 
 void kexCModel::Setup(kexWorld *world)
 {
+    this->world = world;
     vertices    = world->Vertices();
     sectors     = world->Sectors();
     faces       = world->Faces();
     polys       = world->Polys();
+    facePlanes  = world->FacePlanes();
+    faceFlags   = world->FaceFlags();
+    faceSectors = world->FaceSectors();
 }
 
 //
@@ -58,10 +60,16 @@ void kexCModel::Setup(kexWorld *world)
 
 void kexCModel::Reset(void)
 {
+    world       = NULL;
     vertices    = NULL;
+    numQueryActors = 0;
+    bQueryOverflow = true;
     sectors     = NULL;
     faces       = NULL;
     polys       = NULL;
+    facePlanes  = NULL;
+    faceFlags   = NULL;
+    faceSectors = NULL;
 }
 
 //
@@ -579,113 +587,153 @@ void kexCModel::TraceActorsInSector(mapSector_t *sector)
         return;
     }
     
+    if(!bQueryOverflow)
+    {
+        // only the actors near the trace that are linked in this sector
+        for(unsigned int i = 0; i < numQueryActors; ++i)
+        {
+            if(queryActors[i]->Sector() == sector)
+            {
+                TraceActor(queryActors[i]);
+            }
+        }
+        return;
+    }
+
     // test all linked actors in this sector
     for(kexActor *actor = sector->actorList.Next();
         actor != NULL;
         actor = actor->SectorLink().Next())
     {
-        float r;
-        
-        if(actor == sourceActor)
-        {
-            // don't check self
-            continue;
-        }
+        TraceActor(actor);
+    }
+}
 
-        if(!(actor->Flags() & AF_SOLID) &&
-           !(actor->Flags() & AF_TOUCHABLE) &&
-           !(actor->Flags() & AF_SHOOTABLE))
+//
+// kexCModel::TraceActor
+//
+
+void kexCModel::TraceActor(kexActor *actor)
+{
+    float r;
+    
+    if(actor == sourceActor)
+    {
+        // don't check self
+        return;
+    }
+
+    if(!(actor->Flags() & AF_SOLID) &&
+       !(actor->Flags() & AF_TOUCHABLE) &&
+       !(actor->Flags() & AF_SHOOTABLE))
+    {
+        // ignore this actor
+        return;
+    }
+    
+    // if we're doing movement collision tests then perform a 2D-intersection
+    // test with the actor's radial bounds, otherwise do 3D-intersection when
+    // performing ray-trace tests.
+    if(moveActor)
+    {
+        float underLip, z, height;
+        bool bTestOnly = false;
+        bool bTestProjectile = false;
+        bool bIsAProjectile = moveActor->InstanceOf(&kexProjectile::info);
+
+        if(bIsAProjectile && actor == moveActor->Target())
         {
-            // ignore this actor
-            continue;
+            // don't let projectiles collide with its source/owner
+            return;
         }
-        
-        // if we're doing movement collision tests then perform a 2D-intersection
-        // test with the actor's radial bounds, otherwise do 3D-intersection when
-        // performing ray-trace tests.
-        if(moveActor)
-        {
-            float underLip, z, height;
-            bool bTestOnly = false;
-            bool bTestProjectile = false;
-            bool bIsAProjectile = moveActor->InstanceOf(&kexProjectile::info);
 
-            if(bIsAProjectile && actor == moveActor->Target())
-            {
-                // don't let projectiles collide with its source/owner
-                continue;
-            }
+        underLip = actor->Radius() - actor->StepHeight();
 
-            underLip = actor->Radius() - actor->StepHeight();
-
-            if(underLip < 0 || bIsAProjectile)
-            {
-                underLip = 0;
-            }
+        if(underLip < 0 || bIsAProjectile)
+        {
+            underLip = 0;
+        }
 
-            z = actor->Origin().z;
-            height = actor->Height() + underLip;
+        z = actor->Origin().z;
+        height = actor->Height() + underLip;
 
-            if(end.z > z + height || actorHeight + end.z < (z - underLip))
-            {
-                // either over or under actor
-                continue;
-            }
+        if(end.z > z + height || actorHeight + end.z < (z - underLip))
+        {
+            // either over or under actor
+            return;
+        }
 
-            r = (actor->Radius() * 0.5f) + moveActor->Radius();
-            bTestProjectile = (bIsAProjectile && actor->Flags() & AF_SHOOTABLE);
+        r = (actor->Radius() * 0.5f) + moveActor->Radius();
+        bTestProjectile = (bIsAProjectile && actor->Flags() & AF_SHOOTABLE);
 
-            // do actual collision if the following conditions are met:
-            // 1: the actor is solid
-            // 2: the moveactor is a projectile AND the actor we're testing is shootable
-            // 3: the actor is touchable
+        // do actual collision if the following conditions are met:
+        // 1: the actor is solid
+        // 2: the moveactor is a projectile AND the actor we're testing is shootable
+        // 3: the actor is touchable
 
-            if(!bTestProjectile && (actor->Flags() & AF_SOLID) == 0)
-            {
-                bTestOnly = true;
-            }
-            
-            if(TraceSphere(r, actor->Origin().ToVec2(), z + height, 0, bTestOnly))
-            {   
-                if(actor->Flags() & AF_TOUCHABLE)
-                {
-                    actor->OnTouch(moveActor);
-                }
-                
-                if(actor->Flags() & AF_SOLID || bTestProjectile)
-                {
-                    contactActor = actor;
-                    contactSector = actor->Sector();
-                }
-            }
-        }
-        else if(actor->Flags() & (AF_SOLID|AF_SHOOTABLE))
+        if(!bTestProjectile && (actor->Flags() & AF_SOLID) == 0)
         {
-            float z;
-            float d;
-            float minz = 0;
-            kexVec3 vOrg = actor->Origin();
-
-            if(actor->InstanceOf(&kexAI::info) && static_cast<kexAI*>(actor)->AIFlags() & AIF_FLYING)
+            bTestOnly = true;
+        }
+        
+        if(TraceSphere(r, actor->Origin().ToVec2(), z + height, 0, bTestOnly))
+        {   
+            if(actor->Flags() & AF_TOUCHABLE)
             {
-                minz = -actor->StepHeight();
+                actor->OnTouch(moveActor);
             }
             
-            // adjust z-height of the testing sphere. this will closely mimic
-            // doing a trace against a capsule
-            d = kexMath::Sqrt(vOrg.DistanceSq(start) / end.DistanceSq(start));
-            z = ((end.z - start.z) * d + start.z) - vOrg.z;
-            
-            kexMath::Clamp(z, minz, actor->Height());
-            r = actor->Radius();
-            
-            if(TraceSphere(r, vOrg + kexVec3(0, 0, z)))
+            if(actor->Flags() & AF_SOLID || bTestProjectile)
             {
                 contactActor = actor;
                 contactSector = actor->Sector();
             }
         }
     }
+    else if(actor->Flags() & (AF_SOLID|AF_SHOOTABLE))
+    {
+        float z;
+        float d;
+        float minz = 0;
+        kexVec3 vOrg = actor->Origin();
+
+        if(actor->InstanceOf(&kexAI::info) && static_cast<kexAI*>(actor)->AIFlags() & AIF_FLYING)
+        {
+            minz = -actor->StepHeight();
+        }
+        
+        // adjust z-height of the testing sphere. this will closely mimic
+        // doing a trace against a capsule
+        d = kexMath::Sqrt(vOrg.DistanceSq(start) / end.DistanceSq(start));
+        z = ((end.z - start.z) * d + start.z) - vOrg.z;
+        
+        kexMath::Clamp(z, minz, actor->Height());
+        r = actor->Radius();
+        
+        if(TraceSphere(r, vOrg + kexVec3(0, 0, z)))
+        {
+            contactActor = actor;
+            contactSector = actor->Sector();
+        }
+    }
+}
+
+//
+// kexCModel::QueryActors
+//
+// Gathers the actors linked near the current trace so that
+// TraceActorsInSector doesn't have to walk every actor in
+// the sectors it visits
+//
+
+void kexCModel::QueryActors(const float radius)
+{
+    unsigned int count;
+
+    count = world->AreaNodes().QueryRay(start, end, radius, queryActors, MaxQueryActors);
+
+    bQueryOverflow = (count > MaxQueryActors);
+    numQueryActors = bQueryOverflow ? 0 : count;
 }
 
 //
@@ -1001,48 +1049,40 @@ float kexCModel::GetCeilingHeight(const kexVec3 &origin, mapSector_t *sector, bo
 
 void kexCModel::GetContactSectors(mapSector_t *initial)
 {
-    unsigned int sectorCount = 0;
+    kexSectorWalk *walk;
+    mapSector_t *sec;
+
+    QueryActors(moveActor->Radius());
     
-    sectorList.Reset();
-    sectorList.Set(initial);
-    initial->validcount = validcount;
+    walk = world->AcquireWalk();
+    walk->Start(initial, &sectorList);
     
-    do
+    while((sec = walk->Next()) != NULL)
     {
-        mapSector_t *sec = sectorList[sectorCount++];
-        
         TraceActorsInSector(sec);
-        
-        for(int i = sec->faceStart; i < sec->faceEnd+3; ++i)
-        {
-            mapFace_t *face = &faces[i];
-            mapSector_t *s;
-            
-            if(!(face->flags & FF_PORTAL) || face->sector <= -1)
-            {
-                // could be a solid wall or something
-                continue;
-            }
-            
-            s = &sectors[face->sector];
-            
-            if(s->validcount == validcount)
-            {
-                // we already checked this sector
-                continue;
-            }
-            
-            // is this linked sector reachable?
-            if(actorBounds.IntersectingBox(s->bounds))
-            {
-                sectorList.Set(s);
-                s->validcount = validcount;
-            }
-        }
-        
-    } while(sectorCount < sectorList.CurrentLength());
+        walk->WalkPortals(sec, ContactSectorEdge, this);
+    }
+    
+    world->ReleaseWalk(walk);
+}
+
+//
+// kexCModel::ContactSectorEdge
+//
+
+walkEdge_t kexCModel::ContactSectorEdge(kexSectorWalk *walk, mapSector_t *from, mapSector_t *next,
+                                        const mapPortal_t *portal, void *data)
+{
+    kexCModel *cm = (kexCModel*)data;
+    
+    if(walk->IsMarked(next))
+    {
+        // we already checked this sector
+        return WALK_SKIP;
+    }
     
-    validcount++;
+    // is this linked sector reachable?
+    return cm->actorBounds.IntersectingBox(next->bounds) ? WALK_ENTER : WALK_SKIP;
 }
 
 //
@@ -1060,7 +1100,7 @@ void kexCModel::CheckSurroundingSectors(void)
     float maxfloorz, maxceilingz;
     float floorz, ceilingz, diff;
     bool bChangeFloorHeight, bChangeCeilingHeight;
-    unsigned int sectorCount = 0;
+    kexSectorWalk *walk;
     
     maxfloorz = moveActor->FloorHeight();
     maxceilingz = end.z;
@@ -1068,40 +1108,41 @@ void kexCModel::CheckSurroundingSectors(void)
     bChangeFloorHeight = false;
     bChangeCeilingHeight = false;
     
-    sectorList.Reset();
-    sectorList.Set(moveActor->Sector());
-    moveActor->Sector()->validcount = validcount;
+    walk = world->AcquireWalk();
+    walk->Start(moveActor->Sector(), &sectorList);
     
-    do
+    while((sec = walk->Next()) != NULL)
     {
-        sec = sectorList[sectorCount++];
+
+        const int secnum = sec - sectors;
+        mapPortal_t *portal = world->SectorPortals(secnum);
         
-        for(int i = sec->faceStart; i < sec->faceEnd+1; ++i)
+        for(uint i = 0; i < world->NumSectorPortals(secnum); ++i, ++portal)
         {
-            mapFace_t *face = &faces[i];
+            mapFace_t *face;
             mapSector_t *s;
             
-            if(!(face->flags & FF_PORTAL) || face->sector <= -1)
+            if(portal->face > sec->faceEnd)
             {
-                // could be a solid wall or something
-                continue;
+                // only walls, the list is in face order
+                break;
             }
             
-            s = &sectors[face->sector];
+            face = &faces[portal->face];
+            s = &sectors[portal->sector];
             
             if(!PointWithinSectorEdges(end, s, -actorRadius))
             {
                 continue;
             }
             
-            if(s->validcount == validcount)
+            if(walk->IsMarked(s))
             {
                 // we already checked this sector
                 continue;
             }
             
-            sectorList.Set(s);
-            s->validcount = validcount;
+            walk->Enter(s);
             
             if(!CheckEdgeSide(end, face->BottomEdge(), face, actorRadius) &&
                !CheckEdgeSide(end, face->TopEdge(), face, actorRadius))
@@ -1149,8 +1190,9 @@ void kexCModel::CheckSurroundingSectors(void)
                 }
             }
         }
-        
-    } while(sectorCount < sectorList.CurrentLength());
+    }
+    
+    world->ReleaseWalk(walk);
     
     if(bChangeFloorHeight && best && best->floorFace->flags & FF_SOLID)
     {
@@ -1182,8 +1224,6 @@ void kexCModel::CheckSurroundingSectors(void)
             moveActor->CeilingHeight() = maxceilingz;
         }
     }
-    
-    validcount++;
 }
 
 //
@@ -1435,15 +1475,14 @@ bool kexCModel::Trace(kexActor *actor, mapSector_t *sector,
                       const kexVec3 &start_pos, const kexVec3 &end_pos,
                       const float radius, bool bTestActors)
 {
-    unsigned int sectorCount;
+    kexSectorWalk *walk;
+    mapSector_t *s;
 
     if(sector == NULL)
     {
         return false;
     }
 
-    sectorList.Reset();
-
     moveActor = NULL;
     sourceActor = actor;
     actorRadius = 0;
@@ -1458,14 +1497,16 @@ bool kexCModel::Trace(kexActor *actor, mapSector_t *sector,
     contactFace = NULL;
     contactActor = NULL;
 
-    sectorList.Set(sector);
-    sector->validcount = validcount;
-    sectorCount = 0;
-
-    do
+    if(bTestActors)
     {
-        mapSector_t *s = sectorList[sectorCount++];
+        QueryActors(0);
+    }
 
+    walk = world->AcquireWalk();
+    walk->Start(sector, &sectorList);
+
+    while((s = walk->Next()) != NULL)
+    {
         if(bTestActors)
         {
             // check for actors in this sector
@@ -1474,29 +1515,31 @@ bool kexCModel::Trace(kexActor *actor, mapSector_t *sector,
 
         for(int i = s->faceStart; i < s->faceEnd+3; ++i)
         {
-            mapFace_t *face = &faces[i];
+            const uint flags = faceFlags[i];
 
-            if(face->plane.Dot(moveDir) > 0)
+            if(facePlanes[i].Dot(moveDir) > 0)
             {
                 // ray isn't facing the plane
                 continue;
             }
 
-            if(face->flags & FF_PORTAL && face->sector >= 0)
+            if(flags & FF_PORTAL && faceSectors[i] >= 0)
             {
-                if(sectors[face->sector].validcount == validcount)
+                if(walk->IsMarked(&sectors[faceSectors[i]]))
                 {
                     // we already checked this sector
                     continue;
                 }
 
+                mapFace_t *face = &faces[i];
+
                 // test if the trace intersected the portal. immediately enter
                 // next sector if its a water surface
-                if(face->flags & FF_WATER || TraceFacePlane(face, 0, radius, true))
+                if(flags & FF_WATER || TraceFacePlane(face, 0, radius, true))
                 {
-                    mapSector_t *next = &sectors[face->sector];
+                    mapSector_t *next = &sectors[faceSectors[i]];
 
-                    if(face->flags & FF_WATER)
+                    if(flags & FF_WATER)
                     {
                         if( face->plane.Distance(start) >= 0 &&
                             face->plane.Distance(end) >= 0)
@@ -1508,28 +1551,26 @@ bool kexCModel::Trace(kexActor *actor, mapSector_t *sector,
                     }
 
                     // add to list if the ray passes through the portal
-                    sectorList.Set(next);
-                    next->validcount = validcount;
+                    walk->Enter(next);
                     contactSector = next;
                 }
             }
-            else if(face->flags & FF_SOLID)
+            else if(flags & FF_SOLID)
             {
                 if(i <= s->faceEnd)
                 {
                     // test solid wall
-                    TraceFacePlane(face, 0, radius);
+                    TraceFacePlane(&faces[i], 0, radius);
                 }
                 else
                 {
                     // test ceiling/floor
-                    TestIntersectSector(face, radius);
+                    TestIntersectSector(&faces[i], radius);
                 }
             }
         }
+    }
 
-    } while(sectorCount < sectorList.CurrentLength());
-
-    validcount++;
+    world->ReleaseWalk(walk);
     return (fraction != 1);
 }
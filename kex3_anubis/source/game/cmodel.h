@@ -47,7 +47,6 @@ public:
     bool                    ActorTouchingFace(kexActor *actor, mapFace_t *face);
     void                    Reset(void);
 
-    const int               ValidCount(void) const { return validcount; }
     mapFace_t               *ContactFace(void) { return contactFace; }
     kexActor                *ContactActor(void) { return contactActor; }
     mapSector_t             *ContactSector(void) { return contactSector; }
@@ -57,6 +56,8 @@ public:
 
 private:
     void                    TraceActorsInSector(mapSector_t *sector);
+    void                    TraceActor(kexActor *actor);
+    void                    QueryActors(const float radius);
     void                    CollideActorWithWorld(void);
     void                    AdvanceActorToSector(void);
     void                    SlideAgainstFaces(mapSector_t *sector);
@@ -71,13 +72,23 @@ private:
     bool                    TraceSphere(const float radius, const kexVec3 &point);
     void                    PushFromRadialBounds(const kexVec2 &point, const float radius = 0);
     void                    GetContactSectors(mapSector_t *initial);
+    static walkEdge_t       ContactSectorEdge(kexSectorWalk *walk, mapSector_t *from, mapSector_t *next,
+                                              const mapPortal_t *portal, void *data);
 
+    kexWorld                *world;
     mapVertex_t             *vertices;
     mapSector_t             *sectors;
     mapFace_t               *faces;
     mapPoly_t               *polys;
+    kexPlane                *facePlanes;
+    uint                    *faceFlags;
+    short                   *faceSectors;
 
-    static int              validcount;
+    static const unsigned int MaxQueryActors = 128;
+
+    kexActor                *queryActors[MaxQueryActors];
+    unsigned int            numQueryActors;
+    bool                    bQueryOverflow;
 
     sectorList_t            sectorList;
     kexActor                *moveActor;
@@ -519,6 +519,7 @@ kexGameLocal::~kexGameLocal(void)
 void kexGameLocal::Init(void)
 {
     bool bHasUserConfig;
+    kexStrList startupFiles;
 
     kex::cActions->AddAction(IA_ATTACK, "attack");
     kex::cActions->AddAction(IA_JUMP, "jump");
@@ -550,6 +551,14 @@ void kexGameLocal::Init(void)
         }
     }
 
+    startupFiles.Push("defs/weaponInfo.txt");
+    startupFiles.Push("defs/mapInfo.txt");
+    startupFiles.Push("defs/animPicInfo.txt");
+    startupFiles.Push("scripts/main.txt");
+    startupFiles.Push("scripts/actions.txt");
+
+    kex::cPakFiles->PrefetchFiles(startupFiles);
+
     actorDefs.LoadFilesInDirectory("defs/actors/");
     weaponDefs.LoadFile("defs/weaponInfo.txt");
     mapDefs.LoadFile("defs/mapInfo.txt");
@@ -571,8 +580,16 @@ void kexGameLocal::Init(void)
 
 void kexGameLocal::Start(void)
 {
+    kexStrList startupFiles;
+
     bNoMonsters = (kex::cSystem->CheckParam("-nomonsters") > 0);
 
+    startupFiles.Push("fonts/smallfont.kfont");
+    startupFiles.Push("fonts/bigfont.kfont");
+    startupFiles.Push("localization/localization.dat");
+
+    kex::cPakFiles->PrefetchFiles(startupFiles);
+
     smallFont   = kexFont::Alloc("smallfont");
     bigFont     = kexFont::Alloc("bigfont");
 
@@ -597,6 +614,8 @@ void kexGameLocal::Start(void)
 
     loadingPic.Delete();
 
+    kex::cPakFiles->PrintLoadTimes("Startup");
+
     StartNewGame();
 }
 
@@ -679,15 +698,10 @@ void kexGameLocal::InitMapDefs(void)
     kexDict *dict;
     mapInfo_t *mapInfo;
     
-    for(int i = 0; i < MAX_HASH; i++)
+    for(int i = 0; i < mapDefs.defs.Length(); i++)
     {
         kexHashList<kexDict>::hashKey_t *hashKey = mapDefs.defs.GetHashKey(i);
         
-        if(hashKey == NULL)
-        {
-            continue;
-        }
-        
         if(hashKey->refIndex > totalMaps)
         {
             totalMaps = hashKey->refIndex;
@@ -987,7 +1001,7 @@ void kexGameLocal::ClearMenu(const bool bClearAll)
 
 void kexGameLocal::PlaySound(const char *name)
 {
-    kex::cSound->Play((void*)name, 128, 0);
+    kex::cSound->Play(kexAtom(name), 128, 0);
 }
 
 //
@@ -1067,6 +1081,8 @@ void kexGameLocal::ChangeMap(const char *name)
 {
     SetGameState(GS_CHANGELEVEL);
     pendingMap = name;
+
+    kexGame::cWorld->PrefetchMap(name);
 }
 
 //
@@ -1075,6 +1091,8 @@ void kexGameLocal::ChangeMap(const char *name)
 
 void kexGameLocal::LoadNewMap(void)
 {
+    uint64_t loadTime;
+
     for(unsigned int i = 0; i < mapInfoList.Length(); ++i)
     {
         if(!kexStr::Compare(pendingMap, mapInfoList[i].map))
@@ -1089,11 +1107,20 @@ void kexGameLocal::LoadNewMap(void)
         RestorePersistentData();
     }
 
+    loadTime = kex::cTimer->GetPerformanceCounter();
+
     if(!kexGame::cWorld->LoadMap(pendingMap.c_str()))
     {
         SetGameState(GS_TITLE);
         return;
     }
+
+    // file reads, inflating and texture decoding should have mostly been done on the
+    // worker threads while the last screen faded out; this is what's left blocking
+    loadTime = kex::cTimer->GetPerformanceCounter() - loadTime;
+    kex::cSystem->Printf("%s loaded in %fms\n", pendingMap.c_str(),
+                         kex::cTimer->MeasurePerformance(loadTime));
+    kex::cPakFiles->PrintLoadTimes(pendingMap.c_str());
     
     SetGameState(GS_LEVEL);
 }
@@ -140,7 +140,7 @@ const bool kexGameObject::GetSoundParameters(float &volume, float &pan)
 // kexGameObject::PlaySound
 //
 
-void kexGameObject::PlaySound(const char *snd)
+void kexGameObject::PlaySound(const kexAtom &snd)
 {
     float volume;
     float pan;
@@ -150,7 +150,7 @@ void kexGameObject::PlaySound(const char *snd)
         return;
     }
 
-    kex::cSound->Play((void*)snd, (int)volume, (int)pan, this);
+    kex::cSound->Play(snd, (int)volume, (int)pan, this);
 }
 
 //
@@ -174,7 +174,7 @@ void kexGameObject::StopSound(void)
 // kexGameObject::PlayLoopingSound
 //
 
-void kexGameObject::PlayLoopingSound(const char *snd)
+void kexGameObject::PlayLoopingSound(const kexAtom &snd)
 {
     float volume;
     float pan;
@@ -198,7 +198,7 @@ void kexGameObject::PlayLoopingSound(const char *snd)
         return;
     }
 
-    kex::cSound->Play((void*)snd, (int)volume, (int)pan, this, true);
+    kex::cSound->Play(snd, (int)volume, (int)pan, this, true);
 }
 
 //
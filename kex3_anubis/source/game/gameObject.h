@@ -37,10 +37,12 @@ public:
     void                        SetTarget(kexGameObject *targ);
     const bool                  Removing(void) const;
     const bool                  GetSoundParameters(float &volume, float &pan);
-    void                        PlaySound(const char *snd);
-    void                        PlayLoopingSound(const char *snd);
-    void                        PlaySound(const kexStr &snd) { PlaySound(snd.c_str()); }
-    void                        PlayLoopingSound(const kexStr &snd) { PlayLoopingSound(snd.c_str()); }
+    void                        PlaySound(const kexAtom &snd);
+    void                        PlayLoopingSound(const kexAtom &snd);
+    void                        PlaySound(const char *snd) { PlaySound(kexAtom(snd)); }
+    void                        PlayLoopingSound(const char *snd) { PlayLoopingSound(kexAtom(snd)); }
+    void                        PlaySound(const kexStr &snd) { PlaySound(kexAtom(snd)); }
+    void                        PlayLoopingSound(const kexStr &snd) { PlayLoopingSound(kexAtom(snd)); }
     void                        StopSound(void);
     void                        StopLoopingSounds(void);
 
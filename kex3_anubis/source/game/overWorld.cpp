@@ -466,6 +466,9 @@ void kexOverWorld::Tick(void)
         bFadeIn = false;
         fadeTime = 0;
         curFadeTime = 0;
+
+        // start reading the map while the screen fades out
+        kexGame::cWorld->PrefetchMap(map->map);
     }
     else if(buttons & GBE_MENU_UP || cmd->ButtonHeldTime(IA_FORWARD) == 1)
     {
@@ -89,6 +89,15 @@ void kexPlayerWeapon::ChangeAnim(const char *animName)
 // kexPlayerWeapon::ChangeAnim
 //
 
+void kexPlayerWeapon::ChangeAnim(const kexAtom &animName)
+{
+    ChangeAnim(kexGame::cLocal->SpriteAnimManager()->Get(animName));
+}
+
+//
+// kexPlayerWeapon::ChangeAnim
+//
+
 void kexPlayerWeapon::ChangeAnim(const weaponState_t changeState)
 {
     const kexGameLocal::weaponInfo_t *weaponInfo = kexGame::cLocal->WeaponInfo(owner->CurrentWeapon());
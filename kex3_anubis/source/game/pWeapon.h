@@ -27,6 +27,7 @@ public:
     void                        ChangeAnim(spriteAnim_t *changeAnim);
     void                        ChangeAnim(const weaponState_t changeState);
     void                        ChangeAnim(const char *animName);
+    void                        ChangeAnim(const kexAtom &animName);
     void                        Update(void);
     void                        Draw(void);
 
@@ -57,7 +57,7 @@ void kexPickup::Tick(void)
 
 void kexPickup::OnTouch(kexActor *instigator)
 {
-    if(pickupSound.Length() > 0)
+    if(!pickupSound.IsEmpty())
     {
         instigator->PlaySound(pickupSound);
     }
@@ -749,7 +749,7 @@ void kexTeamDollPickup::OnTouch(kexActor *instigator)
         int dollsCollected = 0;
 
         player->TeamDolls() |= BIT(bits);
-        kexGame::cLocal->PlayLoop()->InventoryMenu().ShowArtifact(-1, pickupSound.Length() != 0);
+        kexGame::cLocal->PlayLoop()->InventoryMenu().ShowArtifact(-1, !pickupSound.IsEmpty());
 
         for(int i = 0; i < 32; ++i)
         {
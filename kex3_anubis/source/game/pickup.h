@@ -34,7 +34,7 @@ public:
     void                            Spawn(void);
 
 protected:
-    kexStr                          pickupSound;
+    kexAtom                         pickupSound;
     kexStr                          pickupMessage;
 END_KEX_CLASS();
 
@@ -477,6 +477,9 @@ void kexPlayLoop::RequestExit(const char *map)
     bNoFadeOutPause = false;
     bRestartLevel = false;
 
+    // start reading the next map while this one fades out
+    kexGame::cWorld->PrefetchMap(map);
+
     kexGame::cLocal->SavePersistentData();
     kexGame::cLocal->SaveGame();
 }
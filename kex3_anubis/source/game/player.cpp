@@ -97,6 +97,7 @@ bool kexPuppet::OnCollide(kexCModel *cmodel)
                             f->flags &= ~(FF_SOLID|FF_FORCEFIELD);
                             f->flags |= (FF_INVISIBLE|FF_HIDDEN);
                             f->polyStart = f->polyEnd = -1;
+                            world->UpdateFaceHotData(f);
                         }
                     }
                 }
@@ -104,6 +105,7 @@ bool kexPuppet::OnCollide(kexCModel *cmodel)
                 face->flags &= ~(FF_SOLID|FF_FORCEFIELD);
                 face->flags |= (FF_INVISIBLE|FF_HIDDEN);
                 face->polyStart = face->polyEnd = -1;
+                kexGame::cWorld->UpdateFaceHotData(face);
 
                 PlaySound("sounds/forcefieldoff.wav");
             }
@@ -1183,6 +1185,7 @@ void kexPlayer::Ready(void)
             kexPuppet::bScheduleNextMapWarp = false;
             actor->Origin() = kexPuppet::mapDestinationPosition;
             actor->FindSector(actor->Origin());
+            actor->LinkArea();
         }
         
         kexGame::cWorld->EnterSectorSpecial(actor, actor->Sector());
@@ -282,6 +282,13 @@ bool kexProjectile::CheckSeekTarget(kexVec3 &start, kexActor *actor)
     if(kexMath::Fabs(origin.y - actor->Origin().y) >= homingMaxSightDistance) return false;
 
     kexVec3 end = actor->Origin() + kexVec3(0, 0, actor->Height() * 0.5f);
+    kexWorld *world = kexGame::cWorld;
+
+    if(actor->Sector() &&
+       !world->SectorPotentiallyVisible(sector - world->Sectors(), actor->Sector() - world->Sectors()))
+    {
+        return false;
+    }
 
     if(kexGame::cLocal->CModel()->Trace(this, sector, start, end, 0, false))
     {
@@ -306,31 +313,49 @@ void kexProjectile::SeekTargets(void)
     }
     else
     {
-        sectorList_t *sectorList;
-        sectorList = kexGame::cWorld->FloodFill(start, sector, homingMaxSightDistance);
+        kexActor *localActors[128];
+        kexArray<kexActor*> moreActors;
+        kexActor **actors = localActors;
+        kexBBox box;
+        unsigned int count;
 
-        for(unsigned int i = 0; i < sectorList->CurrentLength(); ++i)
+        box.min.Set(origin.x - homingMaxSightDistance, origin.y - homingMaxSightDistance, 0);
+        box.max.Set(origin.x + homingMaxSightDistance, origin.y + homingMaxSightDistance, 0);
+
+        count = kexGame::cWorld->AreaNodes().QueryBox(box, actors, 128);
+
+        if(count > 128)
         {
-            for(kexActor *actor = (*sectorList)[i]->actorList.Next();
-                actor != NULL;
-                actor = actor->SectorLink().Next())
+            // too many for the local list so query again into one that fits
+            moreActors.Resize(count);
+            actors = &moreActors[0];
+            count = kexGame::cWorld->AreaNodes().QueryBox(box, actors, moreActors.Length());
+
+            if(count > moreActors.Length())
             {
-                if(actor == this || actor == target ||
-                    actor->Health() <= 0 || !(actor->Flags() & AF_SHOOTABLE) ||
-                    !actor->InstanceOf(&kexAI::info))
-                {
-                    continue;
-                }
+                count = moreActors.Length();
+            }
+        }
 
-                if(!CheckSeekTarget(start, actor))
-                {
-                    continue;
-                }
+        for(unsigned int i = 0; i < count; ++i)
+        {
+            kexActor *actor = actors[i];
 
-                if((kexRand::Int() & 7) == 3)
-                {
-                    return;
-                }
+            if(actor == this || actor == target ||
+                actor->Health() <= 0 || !(actor->Flags() & AF_SHOOTABLE) ||
+                !actor->InstanceOf(&kexAI::info))
+            {
+                continue;
+            }
+
+            if(!CheckSeekTarget(start, actor))
+            {
+                continue;
+            }
+
+            if((kexRand::Int() & 7) == 3)
+            {
+                return;
             }
         }
     }
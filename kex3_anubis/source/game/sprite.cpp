@@ -87,6 +87,7 @@ kexSpriteManager::~kexSpriteManager(void)
 void kexSpriteManager::Init(void)
 {
     kexStrList list;
+    kexStrList files;
     spriteInfo_t *info;
 
     kex::cPakFiles->GetMatchingFiles(list, "sprites/");
@@ -97,8 +98,15 @@ void kexSpriteManager::Init(void)
         {
             continue;
         }
-        
-        Load(list[i].c_str());
+
+        files.Push(list[i]);
+    }
+
+    kex::cPakFiles->PrefetchFiles(files);
+
+    for(unsigned int i = 0; i < files.Length(); ++i)
+    {
+        Load(files[i].c_str());
     }
     
     defaultSprite.texture = kexRender::cTextures->defaultTexture;
@@ -118,12 +126,10 @@ void kexSpriteManager::Init(void)
 
 void kexSpriteManager::Shutdown(void)
 {
-    for(int i = 0; i < MAX_HASH; i++)
+    for(int i = 0; i < spriteList.Length(); i++)
     {
-        for(kexSprite *spr = spriteList.GetData(i); spr; spr = spriteList.Next())
-        {
-            spr->Delete();
-        }
+        kexSprite *spr = spriteList.GetData(i);
+        spr->Delete();
     }
 }
 
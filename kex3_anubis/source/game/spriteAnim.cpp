@@ -42,6 +42,7 @@ kexSpriteAnimManager::~kexSpriteAnimManager(void)
 void kexSpriteAnimManager::Init(void)
 {
     kexStrList list;
+    kexStrList files;
     spriteFrame_t *frame;
     spriteSet_t *spriteSet;
 
@@ -53,8 +54,15 @@ void kexSpriteAnimManager::Init(void)
         {
             continue;
         }
-        
-        Load(list[i].c_str());
+
+        files.Push(list[i]);
+    }
+
+    kex::cPakFiles->PrefetchFiles(files);
+
+    for(unsigned int i = 0; i < files.Length(); ++i)
+    {
+        Load(files[i].c_str());
     }
     
     defaultAnim.name = "_default";
@@ -79,13 +87,49 @@ void kexSpriteAnimManager::Init(void)
 
 void kexSpriteAnimManager::Shutdown(void)
 {
-    for(int i = 0; i < MAX_HASH; i++)
+    for(int i = 0; i < spriteAnimList.Length(); i++)
+    {
+        spriteAnim_t *anim = spriteAnimList.GetData(i);
+        anim->frames.Empty();
+    }
+
+    atomLookup.Empty();
+}
+
+//
+// kexSpriteAnimManager::Get
+//
+// Resolves the animation once per atom and caches it
+//
+
+spriteAnim_t *kexSpriteAnimManager::Get(const kexAtom &name)
+{
+    spriteAnim_t *anim;
+
+    if(name.ID() < (int)atomLookup.Length() && (anim = atomLookup[name.ID()]))
+    {
+        return anim;
+    }
+
+    if(!(anim = spriteAnimList.Find(name.c_str())))
     {
-        for(spriteAnim_t *anim = spriteAnimList.GetData(i); anim; anim = spriteAnimList.Next())
+        return NULL;
+    }
+
+    if(name.ID() >= (int)atomLookup.Length())
+    {
+        unsigned int start = atomLookup.Length();
+
+        atomLookup.Resize(kexAtom::NumAtoms());
+
+        for(unsigned int i = start; i < atomLookup.Length(); ++i)
         {
-            anim->frames.Empty();
+            atomLookup[i] = NULL;
         }
     }
+
+    atomLookup[name.ID()] = anim;
+    return anim;
 }
 
 //
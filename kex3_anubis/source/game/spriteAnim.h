@@ -38,12 +38,12 @@ struct spriteFrame_t
     uint16_t                    delay;
     uint16_t                    flags;
     kexArray<kexActionDef*>     actions;
-    kexStr                      nextFrame;
-    kexStr                      refireFrame;
+    kexAtom                     nextFrame;
+    kexAtom                     refireFrame;
     kexArray<spriteSet_t>       spriteSet[8];
 
-    bool                        HasNextFrame(void) { return nextFrame[0] != '-'; }
-    bool                        HasRefireFrame(void) { return refireFrame[0] != '-'; }
+    bool                        HasNextFrame(void) { return nextFrame.c_str()[0] != '-'; }
+    bool                        HasRefireFrame(void) { return refireFrame.c_str()[0] != '-'; }
 };
 
 struct spriteAnim_t
@@ -64,11 +64,13 @@ public:
     void                        Shutdown(void);
 
     spriteAnim_t                *Get(const char *name) { return spriteAnimList.Find(name); }
+    spriteAnim_t                *Get(const kexAtom &name);
     
     spriteAnim_t                defaultAnim;
 
 private:
     kexHashList<spriteAnim_t>   spriteAnimList;
+    kexArray<spriteAnim_t*>     atomLookup;
 
     void                        Load(const char *name);
     void                        ParseFrame(kexLexer *lexer, spriteFrame_t *frame);
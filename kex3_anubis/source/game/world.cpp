@@ -15,6 +15,7 @@
 //      World/Level logic
 //
 
+#include <SDL2/SDL.h>
 #include "kexlib.h"
 #include "game.h"
 #include "mover.h"
@@ -25,6 +26,276 @@ kexWorld *kexGame::cWorld = &worldLocal;
 
 kexHeapBlock kexWorld::hb_world("world", false, NULL, NULL);
 
+kexCvar kexWorld::cvarMapCache("g_mapcache", CVF_BOOL|CVF_CONFIG, "1", "Keep processed maps cached on disk");
+
+// bump whenever anything that ends up in the cache is changed
+#define MAPCACHE_VERSION    2
+#define PVSCACHE_VERSION    2
+
+#define PVS_MAX_THREADS     8
+#define PVS_MAX_PLANES      32
+#define PVS_STEP_LIMIT      0x10000
+#define PVS_VISIT_SIZE      0x100000
+#define PVS_EPSILON         1.0f
+
+enum
+{
+    MCL_VERTICES    = 0,
+    MCL_SECTORS,
+    MCL_FACES,
+    MCL_POLYS,
+    MCL_TEXCOORDS,
+    MCL_EVENTS,
+    NUMMAPCACHELUMPS
+};
+
+//
+// HashMapData
+//
+// FNV-1a over the source map, used to tell if a cache is stale
+//
+
+static uint HashMapData(const byte *data, const uint length)
+{
+    uint hash = 2166136261U;
+
+    for(uint i = 0; i < length; ++i)
+    {
+        hash = (hash ^ data[i]) * 16777619U;
+    }
+
+    return hash;
+}
+
+//
+// benchfacescan
+//
+// Runs the portal test from the trace loop over every face in
+// the map, once through mapFace_t and once through the hot face
+// arrays. The caches are flushed before each scan
+//
+
+COMMAND(benchfacescan)
+{
+    kexWorld *world = kexGame::cWorld;
+    const kexVec3 dir(0.6f, 0.8f, -0.1f);
+    const uint flushSize = 32 << 20;
+    int passes = 100;
+    uint hits[2];
+    uint64_t total[2];
+    uint64_t time;
+    byte *flush;
+
+    if(!world->MapLoaded())
+    {
+        kex::cSystem->Printf("benchfacescan: no map loaded\n");
+        return;
+    }
+
+    if(kex::cCommands->GetArgc() >= 2)
+    {
+        passes = atoi(kex::cCommands->GetArgv(1));
+    }
+
+    if(passes <= 0)
+    {
+        kex::cSystem->Printf("benchfacescan <passes>\n");
+        return;
+    }
+
+    flush = (byte*)Mem_Malloc(flushSize, hb_static);
+    hits[0] = hits[1] = 0;
+    total[0] = total[1] = 0;
+
+    for(int pass = 0; pass < passes; ++pass)
+    {
+        mapFace_t *faces = world->Faces();
+        kexPlane *planes = world->FacePlanes();
+        uint *flags = world->FaceFlags();
+        short *sectors = world->FaceSectors();
+
+        memset(flush, pass, flushSize);
+        time = kex::cTimer->GetPerformanceCounter();
+
+        for(uint s = 0; s < world->NumSectors(); ++s)
+        {
+            mapSector_t *sector = &world->Sectors()[s];
+
+            for(int i = sector->faceStart; i < sector->faceEnd+3; ++i)
+            {
+                if(faces[i].plane.Dot(dir) <= 0 && faces[i].flags & FF_PORTAL && faces[i].sector >= 0)
+                {
+                    hits[0]++;
+                }
+            }
+        }
+
+        total[0] += kex::cTimer->GetPerformanceCounter() - time;
+
+        memset(flush, pass+1, flushSize);
+        time = kex::cTimer->GetPerformanceCounter();
+
+        for(uint s = 0; s < world->NumSectors(); ++s)
+        {
+            mapSector_t *sector = &world->Sectors()[s];
+
+            for(int i = sector->faceStart; i < sector->faceEnd+3; ++i)
+            {
+                if(planes[i].Dot(dir) <= 0 && flags[i] & FF_PORTAL && sectors[i] >= 0)
+                {
+                    hits[1]++;
+                }
+            }
+        }
+
+        total[1] += kex::cTimer->GetPerformanceCounter() - time;
+    }
+
+    Mem_Free(flush);
+
+    if(hits[0] != hits[1])
+    {
+        kex::cSystem->Warning("benchfacescan: hot face data is out of sync (%u/%u)\n", hits[0], hits[1]);
+    }
+
+    kex::cSystem->Printf("%u faces, %i passes\n", world->NumFaces(), passes);
+    kex::cSystem->Printf("mapFace_t:  %fms per scan (%i byte stride)\n",
+                         kex::cTimer->MeasurePerformance(total[0]) / passes, (int)sizeof(mapFace_t));
+    kex::cSystem->Printf("hot arrays: %fms per scan (%i bytes per face)\n",
+                         kex::cTimer->MeasurePerformance(total[1]) / passes,
+                         (int)(sizeof(kexPlane) + sizeof(uint) + sizeof(short)));
+}
+
+//
+// benchcrowd
+//
+// Fills the player's sector with a crowd of actors and gathers
+// the ones in range of random points, once by flooding sectors
+// and walking their actor lists and once through the area nodes
+//
+
+COMMAND(benchcrowd)
+{
+    kexWorld *world = kexGame::cWorld;
+    kexGameLocal *game = kexGame::cLocal;
+    const int numQueries = 1000;
+    int count = 300;
+    float radius = 512;
+    kexActor **crowd;
+    kexActor *found[1024];
+    kexVec3 *points;
+    mapSector_t *sector;
+    int numSpawned = 0;
+    uint hits[2];
+    uint64_t time[2];
+
+    if(game->GameState() != GS_LEVEL || game->Player()->Actor() == NULL)
+    {
+        return;
+    }
+
+    if(kex::cCommands->GetArgc() >= 2) count = atoi(kex::cCommands->GetArgv(1));
+    if(kex::cCommands->GetArgc() >= 3) radius = (float)atof(kex::cCommands->GetArgv(2));
+
+    if(count <= 0 || radius <= 0)
+    {
+        kex::cSystem->Printf("benchcrowd <actors> <radius>\n");
+        return;
+    }
+
+    sector = game->Player()->Actor()->Sector();
+
+    crowd = (kexActor**)Mem_Malloc(sizeof(kexActor*) * count, hb_static);
+    points = (kexVec3*)Mem_Malloc(sizeof(kexVec3) * numQueries, hb_static);
+
+    for(int i = 0; i < count * 8 && numSpawned < count; ++i)
+    {
+        kexVec3 pos(kexRand::Range(sector->bounds.min.x, sector->bounds.max.x),
+                    kexRand::Range(sector->bounds.min.y, sector->bounds.max.y),
+                    (float)sector->floorHeight);
+
+        if(!game->CModel()->PointWithinSectorEdges(pos, sector))
+        {
+            continue;
+        }
+
+        if((crowd[numSpawned] = kexGame::cActorFactory->Spawn(AT_DEBRIS, pos.x, pos.y, pos.z, 0,
+                                                               sector - world->Sectors())))
+        {
+            numSpawned++;
+        }
+    }
+
+    for(int i = 0; i < numQueries; ++i)
+    {
+        points[i] = game->Player()->Actor()->Origin();
+        points[i].x += kexRand::CFloat() * radius;
+        points[i].y += kexRand::CFloat() * radius;
+
+        if(!game->CModel()->PointWithinSectorEdges(points[i], sector))
+        {
+            points[i] = game->Player()->Actor()->Origin();
+        }
+    }
+
+    hits[0] = hits[1] = 0;
+
+    time[0] = kex::cTimer->GetPerformanceCounter();
+
+    for(int i = 0; i < numQueries; ++i)
+    {
+        sectorList_t *sectorList = world->FloodFill(points[i], sector, radius);
+
+        for(uint j = 0; j < sectorList->CurrentLength(); ++j)
+        {
+            for(kexActor *actor = (*sectorList)[j]->actorList.Next();
+                actor != NULL;
+                actor = actor->SectorLink().Next())
+            {
+                if(actor->Origin().ToVec2().DistanceSq(points[i].ToVec2()) <= radius * radius)
+                {
+                    hits[0]++;
+                }
+            }
+        }
+    }
+
+    time[0] = kex::cTimer->GetPerformanceCounter() - time[0];
+    time[1] = kex::cTimer->GetPerformanceCounter();
+
+    for(int i = 0; i < numQueries; ++i)
+    {
+        uint n = world->AreaNodes().QueryRadius(points[i], radius, found, 1024);
+
+        if(n > 1024)
+        {
+            n = 1024;
+        }
+
+        for(uint j = 0; j < n; ++j)
+        {
+            if(found[j]->Origin().ToVec2().DistanceSq(points[i].ToVec2()) <= radius * radius)
+            {
+                hits[1]++;
+            }
+        }
+    }
+
+    time[1] = kex::cTimer->GetPerformanceCounter() - time[1];
+
+    for(int i = 0; i < numSpawned; ++i)
+    {
+        crowd[i]->Remove();
+    }
+
+    Mem_Free(crowd);
+    Mem_Free(points);
+
+    kex::cSystem->Printf("%i actors, %i queries, radius %f\n", numSpawned, numQueries, radius);
+    kex::cSystem->Printf("sector walk: %fms (%u hits)\n", kex::cTimer->MeasurePerformance(time[0]), hits[0]);
+    kex::cSystem->Printf("area nodes:  %fms (%u hits)\n", kex::cTimer->MeasurePerformance(time[1]), hits[1]);
+}
+
 //
 // kexWorld::kexWorld
 //
@@ -41,7 +312,23 @@ kexWorld::kexWorld(void)
     this->events        = NULL;
     this->actors        = NULL;
     this->animPics      = NULL;
+    this->facePlanes    = NULL;
+    this->faceBounds    = NULL;
+    this->faceFlags     = NULL;
+    this->faceSectors   = NULL;
+    this->portalStart   = NULL;
+    this->portalCount   = NULL;
+    this->portals       = NULL;
+    this->toggleStart   = NULL;
+    this->toggleFaces   = NULL;
+    this->passageStart  = NULL;
+    this->passageFaces  = NULL;
+    this->visRowSize    = 0;
+    this->sectorVis     = NULL;
+    this->numActiveWalks = 0;
     this->bMapLoaded    = false;
+    this->mapHash       = 0;
+    this->mapSize       = 0;
 }
 
 //
@@ -52,6 +339,15 @@ kexWorld::~kexWorld(void)
 {
 }
 
+// on-disk record sizes of the map lumps, in bytes
+#define MAPREC_VERTEX_SIZE      10
+#define MAPREC_SECTOR_SIZE      20
+#define MAPREC_FACE_SIZE        32
+#define MAPREC_POLY_SIZE        16
+#define MAPREC_TCOORD_SIZE      32
+#define MAPREC_EVENT_SIZE       8
+#define MAPREC_ACTOR_SIZE       20
+
 //
 // kexWorld::ReadTextures
 //
@@ -160,21 +456,28 @@ void kexWorld::ReadTextures(kexBinFile &mapfile, const unsigned int count)
 
 void kexWorld::ReadVertices(kexBinFile &mapfile, const unsigned int count)
 {
+    const byte *data;
+
     if(count == 0)
     {
         kex::cSystem->Error("kexWorld::ReadVertices - No vertices present\n");
         return;
     }
 
-    for(unsigned int i = 0; i < count; ++i)
+    if(!(data = mapfile.ReadBlock(MAPREC_VERTEX_SIZE, count)))
+    {
+        return;
+    }
+
+    for(unsigned int i = 0; i < count; ++i, data += MAPREC_VERTEX_SIZE)
     {
-        vertices[i].origin.x    = (float)mapfile.Read16();
-        vertices[i].origin.y    = (float)mapfile.Read16();
-        vertices[i].origin.z    = (float)mapfile.Read16();
-        vertices[i].rgba[0]     = mapfile.Read8();
-        vertices[i].rgba[1]     = mapfile.Read8();
-        vertices[i].rgba[2]     = mapfile.Read8();
-        vertices[i].rgba[3]     = mapfile.Read8();
+        vertices[i].origin.x    = (float)kexBinFile::Get16(data+0);
+        vertices[i].origin.y    = (float)kexBinFile::Get16(data+2);
+        vertices[i].origin.z    = (float)kexBinFile::Get16(data+4);
+        vertices[i].rgba[0]     = data[6];
+        vertices[i].rgba[1]     = data[7];
+        vertices[i].rgba[2]     = data[8];
+        vertices[i].rgba[3]     = data[9];
     }
 }
 
@@ -184,12 +487,19 @@ void kexWorld::ReadVertices(kexBinFile &mapfile, const unsigned int count)
 
 void kexWorld::ReadSectors(kexBinFile &mapfile, const unsigned int count)
 {
+    const byte *data;
+
     if(count == 0)
     {
         kex::cSystem->Error("kexWorld::ReadSectors - No sectors present\n");
         return;
     }
 
+    if(!(data = mapfile.ReadBlock(MAPREC_SECTOR_SIZE, count)))
+    {
+        return;
+    }
+
     for(unsigned int i = 0; i < numFaces; ++i)
     {
         mapFace_t *f = &faces[i];
@@ -197,18 +507,17 @@ void kexWorld::ReadSectors(kexBinFile &mapfile, const unsigned int count)
         f->sectorOwner = -1;
     }
 
-    for(unsigned int i = 0; i < count; ++i)
+    for(unsigned int i = 0; i < count; ++i, data += MAPREC_SECTOR_SIZE)
     {
-        sectors[i].faceStart        = mapfile.Read16();
-        sectors[i].faceEnd          = mapfile.Read16();
-        sectors[i].lightLevel       = mapfile.Read16();
-        sectors[i].ceilingHeight    = mapfile.Read16();
-        sectors[i].floorHeight      = mapfile.Read16();
-        sectors[i].ceilingSlope     = mapfile.ReadFloat();
-        sectors[i].floorSlope       = mapfile.ReadFloat();
-        sectors[i].flags            = mapfile.Read16();
+        sectors[i].faceStart        = kexBinFile::Get16(data+0);
+        sectors[i].faceEnd          = kexBinFile::Get16(data+2);
+        sectors[i].lightLevel       = kexBinFile::Get16(data+4);
+        sectors[i].ceilingHeight    = kexBinFile::Get16(data+6);
+        sectors[i].floorHeight      = kexBinFile::Get16(data+8);
+        sectors[i].ceilingSlope     = kexBinFile::GetFloat(data+10);
+        sectors[i].floorSlope       = kexBinFile::GetFloat(data+14);
+        sectors[i].flags            = kexBinFile::Get16(data+18);
         sectors[i].event            = -1;
-        sectors[i].validcount       = -1;
         sectors[i].clipCount        = -1;
         sectors[i].linkedSector     = -1;
         sectors[i].floodCount       = 0;
@@ -236,6 +545,7 @@ void kexWorld::ReadSectors(kexBinFile &mapfile, const unsigned int count)
 void kexWorld::ReadFaces(kexBinFile &mapfile, const unsigned int count)
 {
     unsigned int numPortals = 0;
+    const byte *data;
 
     if(count == 0)
     {
@@ -243,22 +553,27 @@ void kexWorld::ReadFaces(kexBinFile &mapfile, const unsigned int count)
         return;
     }
 
-    for(unsigned int i = 0; i < count; ++i)
+    if(!(data = mapfile.ReadBlock(MAPREC_FACE_SIZE, count)))
+    {
+        return;
+    }
+
+    for(unsigned int i = 0; i < count; ++i, data += MAPREC_FACE_SIZE)
     {
         mapFace_t *f = &faces[i];
         
-        f->polyStart    = mapfile.Read16();
-        f->polyEnd      = mapfile.Read16();
-        f->vertexStart  = mapfile.Read16();
-        f->sector       = mapfile.Read16();
-        f->angle        = mapfile.ReadFloat();
-        f->plane.a      = mapfile.ReadFloat();
-        f->plane.b      = mapfile.ReadFloat();
-        f->plane.c      = mapfile.ReadFloat();
-        f->flags        = mapfile.Read16();
-        f->tag          = mapfile.Read16();
-        f->vertStart    = mapfile.Read16();
-        f->vertEnd      = mapfile.Read16();
+        f->polyStart    = kexBinFile::Get16(data+0);
+        f->polyEnd      = kexBinFile::Get16(data+2);
+        f->vertexStart  = kexBinFile::Get16(data+4);
+        f->sector       = kexBinFile::Get16(data+6);
+        f->angle        = kexBinFile::GetFloat(data+8);
+        f->plane.a      = kexBinFile::GetFloat(data+12);
+        f->plane.b      = kexBinFile::GetFloat(data+16);
+        f->plane.c      = kexBinFile::GetFloat(data+20);
+        f->flags        = kexBinFile::Get16(data+24);
+        f->tag          = kexBinFile::Get16(data+26);
+        f->vertStart    = kexBinFile::Get16(data+28);
+        f->vertEnd      = kexBinFile::Get16(data+30);
         f->validcount   = -1;
         f->x1           = 0;
         f->x2           = 0;
@@ -296,24 +611,31 @@ void kexWorld::ReadFaces(kexBinFile &mapfile, const unsigned int count)
 
 void kexWorld::ReadPolys(kexBinFile &mapfile, const unsigned int count)
 {
+    const byte *data;
+
     if(count == 0)
     {
         kex::cSystem->Error("kexWorld::ReadPolys - No polys present\n");
         return;
     }
 
-    for(unsigned int i = 0; i < count; ++i)
+    if(!(data = mapfile.ReadBlock(MAPREC_POLY_SIZE, count)))
     {
-        polys[i].indices[0] = mapfile.Read8();
-        polys[i].indices[1] = mapfile.Read8();
-        polys[i].indices[2] = mapfile.Read8();
-        polys[i].indices[3] = mapfile.Read8();
-        polys[i].tcoords[0] = mapfile.Read16();
-        polys[i].tcoords[1] = mapfile.Read16();
-        polys[i].tcoords[2] = mapfile.Read16();
-        polys[i].tcoords[3] = mapfile.Read16();
-        polys[i].texture    = mapfile.Read16();
-        polys[i].flipped    = mapfile.Read16();
+        return;
+    }
+
+    for(unsigned int i = 0; i < count; ++i, data += MAPREC_POLY_SIZE)
+    {
+        polys[i].indices[0] = data[0];
+        polys[i].indices[1] = data[1];
+        polys[i].indices[2] = data[2];
+        polys[i].indices[3] = data[3];
+        polys[i].tcoords[0] = kexBinFile::Get16(data+4);
+        polys[i].tcoords[1] = kexBinFile::Get16(data+6);
+        polys[i].tcoords[2] = kexBinFile::Get16(data+8);
+        polys[i].tcoords[3] = kexBinFile::Get16(data+10);
+        polys[i].texture    = kexBinFile::Get16(data+12);
+        polys[i].flipped    = kexBinFile::Get16(data+14);
     }
 
     for(unsigned int i = 0; i < numFaces; ++i)
@@ -347,17 +669,8 @@ void kexWorld::ReadTexCoords(kexBinFile &mapfile, const unsigned int count)
         return;
     }
 
-    for(unsigned int i = 0; i < count; ++i)
-    {
-        texCoords[i].uv[0].s = mapfile.ReadFloat();
-        texCoords[i].uv[0].t = mapfile.ReadFloat();
-        texCoords[i].uv[1].s = mapfile.ReadFloat();
-        texCoords[i].uv[1].t = mapfile.ReadFloat();
-        texCoords[i].uv[2].s = mapfile.ReadFloat();
-        texCoords[i].uv[2].t = mapfile.ReadFloat();
-        texCoords[i].uv[3].s = mapfile.ReadFloat();
-        texCoords[i].uv[3].t = mapfile.ReadFloat();
-    }
+    // stored exactly as laid out in memory
+    mapfile.ReadArray((float*)texCoords, count * 8);
 }
 
 //
@@ -366,17 +679,24 @@ void kexWorld::ReadTexCoords(kexBinFile &mapfile, const unsigned int count)
 
 void kexWorld::ReadEvents(kexBinFile &mapfile, const unsigned int count)
 {
+    const byte *data;
+
     if(count == 0)
     {
         return;
     }
 
-    for(unsigned int i = 0; i < count; ++i)
+    if(!(data = mapfile.ReadBlock(MAPREC_EVENT_SIZE, count)))
+    {
+        return;
+    }
+
+    for(unsigned int i = 0; i < count; ++i, data += MAPREC_EVENT_SIZE)
     {
-        events[i].type      = mapfile.Read16();
-        events[i].sector    = mapfile.Read16();
-        events[i].tag       = mapfile.Read16();
-        events[i].params    = mapfile.Read16();
+        events[i].type      = kexBinFile::Get16(data+0);
+        events[i].sector    = kexBinFile::Get16(data+2);
+        events[i].tag       = kexBinFile::Get16(data+4);
+        events[i].params    = kexBinFile::Get16(data+6);
         
         if(events[i].sector >= 0)
         {
@@ -424,20 +744,16 @@ void kexWorld::ReadEvents(kexBinFile &mapfile, const unsigned int count)
 
             case 25:
                 MakeSectorDynamic(s, false);
-                kexGame::cActorFactory->SpawnMover("kexFloor", events[i].type, events[i].sector);
                 break;
 
             case 41:
             case 44:
             case 45:
+            case 48:
             case 60:
             case 65:
             case 68:
-                SetupFloatingPlatforms(&events[i], s, "kexFloatingPlatform");
-                break;
-
-            case 48:
-                SetupFloatingPlatforms(&events[i], s, "kexDropPad");
+                SetupFloatingPlatforms(&events[i], s);
                 break;
 
             default:
@@ -455,30 +771,87 @@ void kexWorld::ReadEvents(kexBinFile &mapfile, const unsigned int count)
     }
 }
 
+//
+// kexWorld::SpawnEventMovers
+//
+// Kept apart from ReadEvents so the movers get spawned the
+// same way whether the sectors came from the map or the cache
+//
+
+void kexWorld::SpawnEventMovers(void)
+{
+    for(unsigned int i = 0; i < numEvents; ++i)
+    {
+        mapEvent_t *ev = &events[i];
+
+        if(ev->sector < 0)
+        {
+            continue;
+        }
+
+        switch(ev->type)
+        {
+        case 25:
+            kexGame::cActorFactory->SpawnMover("kexFloor", ev->type, ev->sector);
+            break;
+
+        case 41:
+        case 44:
+        case 45:
+        case 60:
+        case 65:
+        case 68:
+            sectors[ev->sector].objectThinker =
+                kexGame::cActorFactory->SpawnMover("kexFloatingPlatform", ev->type, ev->sector);
+            break;
+
+        case 48:
+            sectors[ev->sector].objectThinker =
+                kexGame::cActorFactory->SpawnMover("kexDropPad", ev->type, ev->sector);
+            break;
+
+        default:
+            break;
+        }
+    }
+}
+
 //
 // kexWorld::ReadActors
 //
 
 void kexWorld::ReadActors(kexBinFile &mapfile, const unsigned int count)
 {
+    const byte *data;
+
     if(count == 0)
     {
         kex::cSystem->Error("kexWorld::ReadActors - No actors present; needs at least 1 player actor\n");
         return;
     }
 
+    if(!(data = mapfile.ReadBlock(MAPREC_ACTOR_SIZE, count)))
+    {
+        return;
+    }
+
+    for(unsigned int i = 0; i < count; ++i, data += MAPREC_ACTOR_SIZE)
+    {
+        actors[i].type      = kexBinFile::Get16(data+0);
+        actors[i].sector    = kexBinFile::Get16(data+2);
+        actors[i].x         = kexBinFile::Get16(data+4);
+        actors[i].y         = kexBinFile::Get16(data+6);
+        actors[i].z         = kexBinFile::Get16(data+8);
+        actors[i].tag       = kexBinFile::Get16(data+10);
+        actors[i].params1   = kexBinFile::Get16(data+12);
+        actors[i].params2   = kexBinFile::Get16(data+14);
+        actors[i].angle     = kexBinFile::GetFloat(data+16);
+    }
+
+    kexGame::cActorFactory->ReserveObjects(actors, count);
+
     for(unsigned int i = 0; i < count; ++i)
     {
-        actors[i].type      = mapfile.Read16();
-        actors[i].sector    = mapfile.Read16();
-        actors[i].x         = mapfile.Read16();
-        actors[i].y         = mapfile.Read16();
-        actors[i].z         = mapfile.Read16();
-        actors[i].tag       = mapfile.Read16();
-        actors[i].params1   = mapfile.Read16();
-        actors[i].params2   = mapfile.Read16();
-        actors[i].angle     = mapfile.ReadFloat();
-        
         if(actors[i].sector >= 0)
         {
             SpawnMapActor(&actors[i]);
@@ -492,232 +865,1367 @@ void kexWorld::ReadActors(kexBinFile &mapfile, const unsigned int count)
 
 void kexWorld::BuildPortals(unsigned int count)
 {
-    if(count == 0)
+    BuildSectorGraph();
+
+    for(int i = 0; i < MAX_SECTORWALKS; ++i)
     {
-        return;
+        sectorWalks[i].Init(this, sectors, numSectors, hb_world);
     }
 
-    pvsSize = ((numSectors + 63) & ~63) >> 3;
-    pvsMask = (byte*)Mem_Calloc(pvsSize, hb_world);
+    numActiveWalks = 0;
 }
 
 //
-// kexWorld::BuildAreaNodes
+// kexWorld::BuildSectorGraph
+//
+// Packs the links between sectors into flat per-sector
+// lists so that anything walking from sector to sector only
+// visits faces that lead somewhere
 //
 
-void kexWorld::BuildAreaNodes(void)
+void kexWorld::BuildSectorGraph(void)
 {
-    kexBBox rootBounds;
-    kexVec3 point;
-    
-    areaNodes.Init(8);
-    
-    for(unsigned int i = 0; i < numVertices; ++i)
+    uint numLinks = 0;
+    uint numToggles = 0;
+    uint numPassages = 0;
+
+    portalStart = (uint*)Mem_Malloc(sizeof(uint) * (numSectors+1), hb_world);
+    portalCount = (uint*)Mem_Calloc(sizeof(uint) * (numSectors+1), hb_world);
+    toggleStart = (uint*)Mem_Malloc(sizeof(uint) * (numSectors+1), hb_world);
+    passageStart = (uint*)Mem_Malloc(sizeof(uint) * (numSectors+1), hb_world);
+
+    for(uint i = 0; i < numSectors; ++i)
     {
-        point.Set(vertices[i].origin.x, vertices[i].origin.y, 0);
-        rootBounds.AddPoint(point);
+        portalStart[i] = numLinks;
+        toggleStart[i] = numToggles;
+        passageStart[i] = numPassages;
+
+        for(int j = sectors[i].faceStart; j < sectors[i].faceEnd+3; ++j)
+        {
+            if(faces[j].flags & FF_TOGGLE)
+            {
+                numToggles++;
+            }
+
+            if(faces[j].sector >= 0 && faces[j].flags & (FF_PORTAL|FF_TOGGLE))
+            {
+                numLinks++;
+            }
+            else if(faces[j].sector >= 0)
+            {
+                numPassages++;
+            }
+        }
+    }
+
+    portalStart[numSectors] = numLinks;
+    toggleStart[numSectors] = numToggles;
+    passageStart[numSectors] = numPassages;
+
+    portals = (mapPortal_t*)Mem_Malloc(sizeof(mapPortal_t) * (numLinks+1), hb_world);
+    toggleFaces = (int*)Mem_Malloc(sizeof(int) * (numToggles+1), hb_world);
+    passageFaces = (int*)Mem_Malloc(sizeof(int) * (numPassages+1), hb_world);
+
+    for(uint i = 0; i < numSectors; ++i)
+    {
+        mapPortal_t *list = &portals[portalStart[i]];
+        int *toggles = &toggleFaces[toggleStart[i]];
+        int *passages = &passageFaces[passageStart[i]];
+
+        for(int j = sectors[i].faceStart; j < sectors[i].faceEnd+3; ++j)
+        {
+            if(faces[j].flags & FF_TOGGLE)
+            {
+                *toggles++ = j;
+            }
+            else if(faces[j].sector >= 0 && !(faces[j].flags & FF_PORTAL))
+            {
+                *passages++ = j;
+            }
+
+            if(faces[j].sector >= 0 && faces[j].flags & FF_PORTAL)
+            {
+                list[portalCount[i]].face = j;
+                list[portalCount[i]].sector = faces[j].sector;
+                portalCount[i]++;
+            }
+        }
     }
-    
-    areaNodes.AddBoxToRoot(rootBounds);
-    areaNodes.BuildNodes();
 }
 
 //
-// kexWorld::UpdateSectorBounds
+// kexWorld::LinkSectorPortal
+//
+// Adds a face that has just been opened up to its
+// sector's portal list
 //
 
-void kexWorld::UpdateSectorBounds(mapSector_t *sector)
+void kexWorld::LinkSectorPortal(mapFace_t *face)
 {
-    int end = sector->faceEnd;
-    
-    mapFace_t *f1 = &faces[end+1];
-    mapFace_t *f2 = &faces[end+2];
-    
-    int vs1 = f1->vertexStart;
-    int vs2 = f2->vertexStart;
-    
-    sector->bounds.Clear();
-    
-    sector->bounds.AddPoint(vertices[vs1+0].origin);
-    sector->bounds.AddPoint(vertices[vs1+1].origin);
-    sector->bounds.AddPoint(vertices[vs1+2].origin);
-    sector->bounds.AddPoint(vertices[vs1+3].origin);
-    sector->bounds.AddPoint(vertices[vs2+0].origin);
-    sector->bounds.AddPoint(vertices[vs2+1].origin);
-    sector->bounds.AddPoint(vertices[vs2+2].origin);
-    sector->bounds.AddPoint(vertices[vs2+3].origin);
+    const int facenum = face - faces;
+    const int secnum = face->sectorOwner;
+    mapPortal_t *list;
+    uint count;
+    uint i;
+
+    if(face->sector <= -1 || secnum <= -1)
+    {
+        return;
+    }
+
+    list = SectorPortals(secnum);
+    count = portalCount[secnum];
+
+    for(i = 0; i < count; ++i)
+    {
+        if(list[i].face == facenum)
+        {
+            // already linked
+            return;
+        }
+    }
+
+    if(portalStart[secnum] + count >= portalStart[secnum+1])
+    {
+        kex::cSystem->Warning("kexWorld::LinkSectorPortal - No room for face %i in sector %i\n",
+                              facenum, secnum);
+        return;
+    }
+
+    // keep the list in face order
+    for(i = count; i > 0 && list[i-1].face > facenum; --i)
+    {
+        list[i] = list[i-1];
+    }
+
+    list[i].face = facenum;
+    list[i].sector = face->sector;
+    portalCount[secnum]++;
 }
 
 //
-// kexWorld::UpdateFacePlaneAndBounds
+// Sector PVS
+//
+// A sector can only be seen through a chain of portals if every
+// portal in the chain reaches behind the planes of all the portals
+// before it. Only wall portals are tested and only in 2D, since
+// doors and movers slide sectors up and down but never sideways,
+// and breakable walls are treated as already open. That keeps
+// the result valid no matter what moves or opens during play.
+//
+// Walls that lie on the same line share one plane id. A sector is
+// only walked again if none of the earlier walks into it from the
+// same source were clipped by a subset of the current planes,
+// because those walks already reached everything this one could
 //
 
-void kexWorld::UpdateFacePlaneAndBounds(mapFace_t *face)
+typedef struct
 {
-    face->bounds.Clear();
-    
-    for(int j = 0; j < 4; ++j)
+    kexWorld            *world;
+    const int           *planeIds;
+    const kexPlane      *planes;
+    byte                *row;
+    byte                *planeOnPath;
+    int                 path[PVS_MAX_PLANES];
+    int                 numPlanes;
+    int                 steps;
+    uint                source;
+    uint                *visitStamp;
+    int                 *visitHead;
+    int                 *visits;
+    int                 numVisits;
+} pvsWalk_t;
+
+typedef struct
+{
+    kexWorld            *world;
+    const int           *planeIds;
+    const kexPlane      *planes;
+    int                 numPlaneIds;
+    byte                *vis;
+    uint                rowSize;
+    int                 thread;
+    int                 numThreads;
+} pvsThread_t;
+
+static void PVS_WalkSector(pvsWalk_t *walk, const int secnum);
+
+//
+// PVS_FaceBehindPlane
+//
+
+static bool PVS_FaceBehindPlane(kexWorld *world, const mapFace_t *face, const kexPlane *plane)
+{
+    for(int i = 0; i < 4; ++i)
     {
-        face->bounds.AddPoint(vertices[face->vertexStart+j].origin);
+        const kexVec3 &v = world->Vertices()[face->vertexStart+i].origin;
+
+        if(plane->a * v.x + plane->b * v.y - plane->d < PVS_EPSILON)
+        {
+            return true;
+        }
     }
-    
-    face->plane.SetDistance(vertices[face->vertexStart].origin);
+
+    return false;
 }
 
 //
-// kexWorld::BuildSectorBounds
+// PVS_BuildPlaneIds
+//
+// Gives every wall that links two sectors a plane id, with walls
+// on the same line sharing one. Everything else gets -1. Returns
+// the number of ids handed out
 //
 
-void kexWorld::BuildSectorBounds(void)
+static int PVS_BuildPlaneIds(kexWorld *world, int *planeIds, kexPlane *planes)
 {
-    for(unsigned int i = 0; i < numSectors; ++i)
+    uint hashSize = 1;
+    int *hash;
+    int *keys;
+    int numIds = 0;
+
+    while(hashSize < world->NumFaces() * 2)
     {
-        mapSector_t *sector = &sectors[i];
-        UpdateSectorBounds(sector);
+        hashSize <<= 1;
+    }
+
+    hash = new int[hashSize];
+    keys = new int[world->NumFaces() * 3];
+
+    memset(hash, 0xff, sizeof(int) * hashSize);
+
+    for(uint i = 0; i < world->NumFaces(); ++i)
+    {
+        const mapFace_t *face = &world->Faces()[i];
+        int key[3];
+        uint h;
+
+        planeIds[i] = -1;
+
+        if(face->sector <= -1 || kexMath::Fabs(face->plane.c) >= 0.01f)
+        {
+            continue;
+        }
+
+        key[0] = (int)kexMath::Floor(face->plane.a * 1024 + 0.5f);
+        key[1] = (int)kexMath::Floor(face->plane.b * 1024 + 0.5f);
+        key[2] = (int)kexMath::Floor(face->plane.d * 16 + 0.5f);
+
+        h = ((uint)key[0] * 73856093u ^ (uint)key[1] * 19349663u ^ (uint)key[2] * 83492791u) & (hashSize-1);
+
+        while(hash[h] != -1 && memcmp(&keys[hash[h] * 3], key, sizeof(key)))
+        {
+            h = (h + 1) & (hashSize-1);
+        }
+
+        if(hash[h] == -1)
+        {
+            hash[h] = numIds;
+            memcpy(&keys[numIds * 3], key, sizeof(key));
+            planes[numIds++] = face->plane;
+        }
+
+        planeIds[i] = hash[h];
     }
+
+    delete[] hash;
+    delete[] keys;
+
+    return numIds;
 }
 
 //
-// kexWorld::SetupEdges
+// PVS_Visited
+//
+// True if the sector was already walked from this source
+// with a subset of the planes that are clipping now
 //
 
-void kexWorld::SetupEdges(void)
+static bool PVS_Visited(pvsWalk_t *walk, const int secnum)
 {
-    for(unsigned int i = 0; i < numSectors; ++i)
+    if(walk->visitStamp[secnum] != walk->source)
     {
-        mapSector_t *sector = &sectors[i];
-        int start = sector->faceStart;
-        int end = sector->faceEnd;
-        
-        for(int j = start; j < end+1; ++j)
+        return false;
+    }
+
+    for(int v = walk->visitHead[secnum]; v != -1; v = walk->visits[v])
+    {
+        const int count = walk->visits[v+1];
+        const int *ids = &walk->visits[v+2];
+        int i;
+
+        for(i = 0; i < count; ++i)
         {
-            mapFace_t *face = &faces[j];
+            if(!walk->planeOnPath[ids[i]])
+            {
+                break;
+            }
+        }
 
-            if(face->flags & FF_SOLID)
+        if(i == count)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+//
+// PVS_AddVisit
+//
+// Remembers the planes the sector is being walked with. Returns
+// false once the visit buffer is full
+//
+
+static bool PVS_AddVisit(pvsWalk_t *walk, const int secnum)
+{
+    const int v = walk->numVisits;
+
+    if(v + 2 + walk->numPlanes > PVS_VISIT_SIZE)
+    {
+        return false;
+    }
+
+    if(walk->visitStamp[secnum] != walk->source)
+    {
+        walk->visitStamp[secnum] = walk->source;
+        walk->visitHead[secnum] = -1;
+    }
+
+    walk->visits[v+0] = walk->visitHead[secnum];
+    walk->visits[v+1] = walk->numPlanes;
+    memcpy(&walk->visits[v+2], walk->path, sizeof(int) * walk->numPlanes);
+
+    walk->visitHead[secnum] = v;
+    walk->numVisits += 2 + walk->numPlanes;
+
+    return true;
+}
+
+//
+// PVS_WalkLink
+//
+
+static void PVS_WalkLink(pvsWalk_t *walk, const int facenum)
+{
+    const mapFace_t *face = &walk->world->Faces()[facenum];
+    const int next = face->sector;
+    const int planeId = walk->planeIds[facenum];
+    bool bPushed = false;
+
+    if(next <= -1 || walk->steps > PVS_STEP_LIMIT)
+    {
+        return;
+    }
+
+    if(planeId >= 0)
+    {
+        for(int i = 0; i < walk->numPlanes; ++i)
+        {
+            if(!PVS_FaceBehindPlane(walk->world, face, &walk->planes[walk->path[i]]))
             {
-                continue;
+                return;
             }
-            
-            if(face->polyStart == -1 || face->polyEnd == -1)
+        }
+
+        if(!walk->planeOnPath[planeId] && walk->numPlanes < PVS_MAX_PLANES)
+        {
+            walk->planeOnPath[planeId] = 1;
+            walk->path[walk->numPlanes++] = planeId;
+            bPushed = true;
+        }
+    }
+
+    PVS_WalkSector(walk, next);
+
+    if(bPushed)
+    {
+        walk->planeOnPath[planeId] = 0;
+        walk->numPlanes--;
+    }
+}
+
+//
+// PVS_WalkSector
+//
+
+static void PVS_WalkSector(pvsWalk_t *walk, const int secnum)
+{
+    kexWorld *world = walk->world;
+    mapPortal_t *portal = world->SectorPortals(secnum);
+    int *toggles = world->SectorToggleFaces(secnum);
+
+    if(PVS_Visited(walk, secnum))
+    {
+        return;
+    }
+
+    if(!PVS_AddVisit(walk, secnum))
+    {
+        // out of room, let the caller flood it instead
+        walk->steps = PVS_STEP_LIMIT+1;
+        return;
+    }
+
+    walk->row[secnum >> 3] |= BIT(secnum & 7);
+    walk->steps++;
+
+    for(uint i = 0; i < world->NumSectorPortals(secnum); ++i)
+    {
+        PVS_WalkLink(walk, portal[i].face);
+    }
+
+    for(uint i = 0; i < world->NumSectorToggleFaces(secnum); ++i)
+    {
+        if(!(world->Faces()[toggles[i]].flags & FF_PORTAL))
+        {
+            PVS_WalkLink(walk, toggles[i]);
+        }
+    }
+}
+
+//
+// PVS_FloodSector
+//
+// Fallback for sectors with too many portal chains
+// to walk. Marks everything reachable
+//
+
+static void PVS_FloodSector(kexWorld *world, byte *row, const int secnum)
+{
+    int *queue = new int[world->NumSectors()];
+    uint head = 0;
+    uint tail = 0;
+
+    memset(row, 0, (world->NumSectors() + 7) >> 3);
+    row[secnum >> 3] |= BIT(secnum & 7);
+    queue[tail++] = secnum;
+
+    while(head < tail)
+    {
+        const int sec = queue[head++];
+        mapPortal_t *portal = world->SectorPortals(sec);
+        int *toggles = world->SectorToggleFaces(sec);
+        uint numLinks = world->NumSectorPortals(sec) + world->NumSectorToggleFaces(sec);
+
+        for(uint i = 0; i < numLinks; ++i)
+        {
+            int next;
+
+            if(i < world->NumSectorPortals(sec))
             {
-                mapEdge_t *l1 = face->LeftEdge();
-                mapEdge_t *r1 = face->RightEdge();
-                
-                for(int k = start; k < end+1; ++k)
-                {
-                    if(k == j)
-                    {
-                        continue;
-                    }
-                    
-                    mapFace_t *f = &faces[k];
-                    
-                    if(f->polyStart == -1 || f->polyEnd == -1)
-                    {
-                        continue;
-                    }
-                    
-                    mapEdge_t *l2 = f->LeftEdge();
-                    mapEdge_t *r2 = f->RightEdge();
-                    
-                    if(kexMath::Fabs(r2->v2->z - r1->v1->z) <= 0.001f &&
-                       kexMath::Fabs(l2->v1->z - l1->v2->z) <= 0.001f)
-                    {
-                        f->BottomEdge()->flags |= EGF_TOPSTEP;
-                    }
-                    
-                    if(kexMath::Fabs(r2->v1->z - r1->v2->z) <= 0.001f &&
-                       kexMath::Fabs(l2->v2->z - l1->v1->z) <= 0.001f)
-                    {
-                        f->TopEdge()->flags |= EGF_BOTTOMSTEP;
-                    }
-                }
+                next = portal[i].sector;
+            }
+            else
+            {
+                next = world->Faces()[toggles[i - world->NumSectorPortals(sec)]].sector;
+            }
+
+            if(next <= -1 || row[next >> 3] & BIT(next & 7))
+            {
+                continue;
             }
+
+            row[next >> 3] |= BIT(next & 7);
+            queue[tail++] = next;
+        }
+    }
+
+    delete[] queue;
+}
+
+//
+// kexWorld::SectorPVSThread
+//
+
+int kexWorld::SectorPVSThread(void *data)
+{
+    pvsThread_t *job = static_cast<pvsThread_t*>(data);
+    kexWorld *world = job->world;
+    pvsWalk_t walk;
+
+    walk.world = world;
+    walk.planeIds = job->planeIds;
+    walk.planes = job->planes;
+    walk.planeOnPath = new byte[job->numPlaneIds+1];
+    walk.visitStamp = new uint[world->NumSectors()];
+    walk.visitHead = new int[world->NumSectors()];
+    walk.visits = new int[PVS_VISIT_SIZE];
+    walk.source = 0;
+
+    memset(walk.planeOnPath, 0, job->numPlaneIds+1);
+    memset(walk.visitStamp, 0, sizeof(uint) * world->NumSectors());
+
+    for(uint i = job->thread; i < world->NumSectors(); i += job->numThreads)
+    {
+        walk.row = &job->vis[i * job->rowSize];
+        walk.numPlanes = 0;
+        walk.steps = 0;
+        walk.numVisits = 0;
+        walk.source++;
+
+        PVS_WalkSector(&walk, i);
+
+        if(walk.steps > PVS_STEP_LIMIT)
+        {
+            PVS_FloodSector(world, walk.row, i);
+        }
+    }
+
+    delete[] walk.planeOnPath;
+    delete[] walk.visitStamp;
+    delete[] walk.visitHead;
+    delete[] walk.visits;
+    return 0;
+}
+
+//
+// kexWorld::BuildSectorPVS
+//
+
+void kexWorld::BuildSectorPVS(void)
+{
+    kexThread::kThread_t threads[PVS_MAX_THREADS];
+    pvsThread_t jobs[PVS_MAX_THREADS];
+    int *planeIds;
+    kexPlane *planes;
+    int numPlaneIds;
+    int numThreads;
+    uint64_t time;
+
+    sectorVis = NULL;
+
+    if(numSectors == 0)
+    {
+        return;
+    }
+
+    visRowSize = ((numSectors + 31) & ~31) >> 3;
+    sectorVis = (byte*)Mem_Calloc(visRowSize * numSectors, hb_world);
+
+    if(LoadSectorPVS())
+    {
+        return;
+    }
+
+    time = kex::cTimer->GetPerformanceCounter();
+    numThreads = SDL_GetCPUCount();
+
+    planeIds = new int[numFaces+1];
+    planes = new kexPlane[numFaces+1];
+    numPlaneIds = PVS_BuildPlaneIds(this, planeIds, planes);
+
+    if(numThreads > PVS_MAX_THREADS) numThreads = PVS_MAX_THREADS;
+    if(numThreads > (int)numSectors) numThreads = (int)numSectors;
+    if(numThreads < 1) numThreads = 1;
+
+    for(int i = 0; i < numThreads; ++i)
+    {
+        jobs[i].world = this;
+        jobs[i].planeIds = planeIds;
+        jobs[i].planes = planes;
+        jobs[i].numPlaneIds = numPlaneIds;
+        jobs[i].vis = sectorVis;
+        jobs[i].rowSize = visRowSize;
+        jobs[i].thread = i;
+        jobs[i].numThreads = numThreads;
+    }
+
+    // the main thread takes the first share
+    for(int i = 1; i < numThreads; ++i)
+    {
+        threads[i] = kex::cThread->CreateThread("pvs", &jobs[i], kexWorld::SectorPVSThread);
+    }
+
+    SectorPVSThread(&jobs[0]);
+
+    for(int i = 1; i < numThreads; ++i)
+    {
+        if(threads[i] == NULL)
+        {
+            // couldn't start it so do its share here
+            SectorPVSThread(&jobs[i]);
+            continue;
+        }
+
+        kex::cThread->WaitThread(threads[i], NULL);
+    }
+
+    delete[] planeIds;
+    delete[] planes;
+
+    time = kex::cTimer->GetPerformanceCounter() - time;
+    kex::cSystem->DPrintf("kexWorld::BuildSectorPVS - %i sectors in %fms (%i threads)\n",
+                          numSectors, kex::cTimer->MeasurePerformance(time), numThreads);
+
+    SaveSectorPVS();
+}
+
+//
+// kexWorld::LoadSectorPVS
+//
+
+bool kexWorld::LoadSectorPVS(void)
+{
+    kexBinFile file;
+    const byte *data;
+
+    if(!OpenMapCache(file, ".kpvs", PVSCACHE_VERSION, 1))
+    {
+        return false;
+    }
+
+    if(!(data = MapCacheLump(file, 0, visRowSize, numSectors)))
+    {
+        return false;
+    }
+
+    memcpy(sectorVis, data, visRowSize * numSectors);
+    return true;
+}
+
+//
+// kexWorld::SaveSectorPVS
+//
+
+void kexWorld::SaveSectorPVS(void)
+{
+    const void *lumpData[1];
+    uint lumpSizes[1];
+
+    lumpData[0] = sectorVis;
+    lumpSizes[0] = visRowSize * numSectors;
+
+    WriteMapCache(".kpvs", PVSCACHE_VERSION, lumpData, lumpSizes, 1);
+}
+
+//
+// kexWorld::BuildAreaNodes
+//
+
+void kexWorld::BuildAreaNodes(void)
+{
+    kexBBox rootBounds;
+    kexVec3 point;
+    
+    areaNodes.Init(8);
+    
+    for(unsigned int i = 0; i < numVertices; ++i)
+    {
+        point.Set(vertices[i].origin.x, vertices[i].origin.y, 0);
+        rootBounds.AddPoint(point);
+    }
+    
+    areaNodes.AddBoxToRoot(rootBounds);
+    areaNodes.BuildNodes();
+}
+
+//
+// kexWorld::UpdateSectorBounds
+//
+
+void kexWorld::UpdateSectorBounds(mapSector_t *sector)
+{
+    int end = sector->faceEnd;
+    
+    mapFace_t *f1 = &faces[end+1];
+    mapFace_t *f2 = &faces[end+2];
+    
+    int vs1 = f1->vertexStart;
+    int vs2 = f2->vertexStart;
+    
+    sector->bounds.Clear();
+    
+    sector->bounds.AddPoint(vertices[vs1+0].origin);
+    sector->bounds.AddPoint(vertices[vs1+1].origin);
+    sector->bounds.AddPoint(vertices[vs1+2].origin);
+    sector->bounds.AddPoint(vertices[vs1+3].origin);
+    sector->bounds.AddPoint(vertices[vs2+0].origin);
+    sector->bounds.AddPoint(vertices[vs2+1].origin);
+    sector->bounds.AddPoint(vertices[vs2+2].origin);
+    sector->bounds.AddPoint(vertices[vs2+3].origin);
+}
+
+//
+// kexWorld::UpdateFacePlaneAndBounds
+//
+
+void kexWorld::UpdateFacePlaneAndBounds(mapFace_t *face)
+{
+    face->bounds.Clear();
+    
+    for(int j = 0; j < 4; ++j)
+    {
+        face->bounds.AddPoint(vertices[face->vertexStart+j].origin);
+    }
+    
+    face->plane.SetDistance(vertices[face->vertexStart].origin);
+    UpdateFaceHotData(face);
+}
+
+//
+// kexWorld::UpdateFaceHotData
+//
+// Must be called whenever the face's plane, bounds
+// or any of the FF_HOTFLAGS bits change
+//
+
+void kexWorld::UpdateFaceHotData(mapFace_t *face)
+{
+    const int i = face - faces;
+
+    facePlanes[i]   = face->plane;
+    faceBounds[i]   = face->bounds;
+    faceFlags[i]    = face->flags & FF_HOTFLAGS;
+    faceSectors[i]  = face->sector;
+}
+
+//
+// kexWorld::BuildFaceHotData
+//
+
+void kexWorld::BuildFaceHotData(void)
+{
+    for(unsigned int i = 0; i < numFaces; ++i)
+    {
+        UpdateFaceHotData(&faces[i]);
+    }
+}
+
+//
+// kexWorld::BuildSectorBounds
+//
+
+void kexWorld::BuildSectorBounds(void)
+{
+    for(unsigned int i = 0; i < numSectors; ++i)
+    {
+        mapSector_t *sector = &sectors[i];
+        UpdateSectorBounds(sector);
+    }
+}
+
+//
+// kexWorld::SetupEdges
+//
+
+void kexWorld::SetupEdges(void)
+{
+    for(unsigned int i = 0; i < numSectors; ++i)
+    {
+        mapSector_t *sector = &sectors[i];
+        int start = sector->faceStart;
+        int end = sector->faceEnd;
+        
+        for(int j = start; j < end+1; ++j)
+        {
+            mapFace_t *face = &faces[j];
+
+            if(face->flags & FF_SOLID)
+            {
+                continue;
+            }
+            
+            if(face->polyStart == -1 || face->polyEnd == -1)
+            {
+                mapEdge_t *l1 = face->LeftEdge();
+                mapEdge_t *r1 = face->RightEdge();
+                
+                for(int k = start; k < end+1; ++k)
+                {
+                    if(k == j)
+                    {
+                        continue;
+                    }
+                    
+                    mapFace_t *f = &faces[k];
+                    
+                    if(f->polyStart == -1 || f->polyEnd == -1)
+                    {
+                        continue;
+                    }
+                    
+                    mapEdge_t *l2 = f->LeftEdge();
+                    mapEdge_t *r2 = f->RightEdge();
+                    
+                    if(kexMath::Fabs(r2->v2->z - r1->v1->z) <= 0.001f &&
+                       kexMath::Fabs(l2->v1->z - l1->v2->z) <= 0.001f)
+                    {
+                        f->BottomEdge()->flags |= EGF_TOPSTEP;
+                    }
+                    
+                    if(kexMath::Fabs(r2->v1->z - r1->v2->z) <= 0.001f &&
+                       kexMath::Fabs(l2->v2->z - l1->v1->z) <= 0.001f)
+                    {
+                        f->TopEdge()->flags |= EGF_BOTTOMSTEP;
+                    }
+                }
+            }
+        }
+    }
+}
+
+//
+// kexWorld::SpawnMapActor
+//
+
+void kexWorld::SpawnMapActor(mapActor_t *mapActor)
+{
+    float x, y, z;
+    float an;
+    kexActor *actor;
+    
+    if(mapActor->type <= -1)
+    {
+        return;
+    }
+    
+    x   = (float)mapActor->x;
+    y   = (float)mapActor->y;
+    z   = (float)mapActor->z;
+    an  = kexMath::Deg2Rad((360 - (float)mapActor->angle) + 90);
+    
+    actor = kexGame::cActorFactory->Spawn(mapActor->type, x, y, z, an, mapActor->sector);
+
+    if(!actor)
+    {
+        return;
+    }
+
+    actor->SetMapActor(mapActor);
+}
+
+//
+// kexWorld::MapCachePath
+//
+
+kexStr kexWorld::MapCachePath(const char *ext)
+{
+    kexStr path;
+    char *prefPath;
+    const char *name;
+
+    if(!(prefPath = SDL_GetPrefPath("", "ExhumedEXPlus")))
+    {
+        return path;
+    }
+
+    name = mapName.c_str();
+
+    for(const char *c = name; *c; ++c)
+    {
+        if(*c == '/' || *c == '\\')
+        {
+            name = c+1;
+        }
+    }
+
+    path = kexStr(prefPath) + name + ext;
+    path.NormalizeSlashes();
+
+    SDL_free(prefPath);
+    return path;
+}
+
+//
+// kexWorld::OpenMapCache
+//
+// Maps the cache for the current map, rejecting it if it
+// was built from a different version of the map or code
+//
+
+bool kexWorld::OpenMapCache(kexBinFile &file, const char *ext, const int version, const uint numLumps)
+{
+    const mapCacheHeader_t *header;
+    kexStr path;
+
+    file.Close();
+
+    if(!cvarMapCache.GetBool() || numLumps > MAX_MAPCACHE_LUMPS)
+    {
+        return false;
+    }
+
+    if((path = MapCachePath(ext)).Length() == 0 || !file.OpenMapped(path.c_str()))
+    {
+        return false;
+    }
+
+    header = (const mapCacheHeader_t*)file.Buffer();
+
+    if(file.Length() < (int)sizeof(mapCacheHeader_t) ||
+       memcmp(header->ident, "KMAP", 4) ||
+       header->version != version ||
+       header->mapHash != mapHash ||
+       header->mapSize != mapSize ||
+       header->numLumps != numLumps)
+    {
+        file.Close();
+        return false;
+    }
+
+    for(uint i = 0; i < numLumps; ++i)
+    {
+        const mapCacheLump_t *lump = &header->lumps[i];
+
+        if((lump->offset & 15) != 0 ||
+           (uint64_t)lump->offset + lump->length > (uint64_t)file.Length())
+        {
+            file.Close();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+//
+// kexWorld::MapCacheLump
+//
+// Returns the lump in place or NULL if it doesn't hold
+// exactly count elements of the given size
+//
+
+byte *kexWorld::MapCacheLump(kexBinFile &file, const uint lump, const uint size, const uint count)
+{
+    const mapCacheHeader_t *header = (const mapCacheHeader_t*)file.Buffer();
+
+    if((uint64_t)header->lumps[lump].length != (uint64_t)size * count)
+    {
+        return NULL;
+    }
+
+    return file.Buffer() + header->lumps[lump].offset;
+}
+
+//
+// kexWorld::WriteMapCache
+//
+
+void kexWorld::WriteMapCache(const char *ext, const int version, const void **lumpData,
+                             const uint *lumpSizes, const uint numLumps)
+{
+    static const byte padding[16] = { 0 };
+    mapCacheHeader_t header;
+    kexBinFile file;
+    kexStr path;
+    uint offset;
+
+    if(!cvarMapCache.GetBool() || numLumps > MAX_MAPCACHE_LUMPS)
+    {
+        return;
+    }
+
+    if((path = MapCachePath(ext)).Length() == 0)
+    {
+        return;
+    }
+
+    memset(&header, 0, sizeof(mapCacheHeader_t));
+    memcpy(header.ident, "KMAP", 4);
+
+    header.version = version;
+    header.mapHash = mapHash;
+    header.mapSize = mapSize;
+    header.numLumps = numLumps;
+
+    offset = (sizeof(mapCacheHeader_t) + 15) & ~15;
+
+    for(uint i = 0; i < numLumps; ++i)
+    {
+        header.lumps[i].offset = offset;
+        header.lumps[i].length = lumpSizes[i];
+
+        offset = (offset + lumpSizes[i] + 15) & ~15;
+    }
+
+    if(!file.Create(path.c_str()))
+    {
+        kex::cSystem->DPrintf("kexWorld::WriteMapCache - Couldn't create %s\n", path.c_str());
+        return;
+    }
+
+    file.WriteBytes((const byte*)&header, sizeof(mapCacheHeader_t));
+    offset = sizeof(mapCacheHeader_t);
+
+    for(uint i = 0; i < numLumps; ++i)
+    {
+        file.WriteBytes(padding, header.lumps[i].offset - offset);
+        file.WriteBytes((const byte*)lumpData[i], lumpSizes[i]);
+
+        offset = header.lumps[i].offset + lumpSizes[i];
+    }
+
+    file.Close();
+}
+
+//
+// kexWorld::LoadMapCache
+//
+// The cached arrays are used straight out of the mapping;
+// only the pointers need to be set up again
+//
+
+bool kexWorld::LoadMapCache(void)
+{
+    byte *lumps[NUMMAPCACHELUMPS];
+    unsigned int numPortals = 0;
+
+    if(!OpenMapCache(mapCache, ".kmc", MAPCACHE_VERSION, NUMMAPCACHELUMPS))
+    {
+        return false;
+    }
+
+    lumps[MCL_VERTICES]     = MapCacheLump(mapCache, MCL_VERTICES, sizeof(mapVertex_t), numVertices);
+    lumps[MCL_SECTORS]      = MapCacheLump(mapCache, MCL_SECTORS, sizeof(mapSector_t), numSectors);
+    lumps[MCL_FACES]        = MapCacheLump(mapCache, MCL_FACES, sizeof(mapFace_t), numFaces);
+    lumps[MCL_POLYS]        = MapCacheLump(mapCache, MCL_POLYS, sizeof(mapPoly_t), numPolys);
+    lumps[MCL_TEXCOORDS]    = MapCacheLump(mapCache, MCL_TEXCOORDS, sizeof(mapTexCoords_t), numTCoords);
+    lumps[MCL_EVENTS]       = MapCacheLump(mapCache, MCL_EVENTS, sizeof(mapEvent_t), numEvents);
+
+    for(int i = 0; i < NUMMAPCACHELUMPS; ++i)
+    {
+        if(lumps[i] == NULL)
+        {
+            mapCache.Close();
+            return false;
+        }
+    }
+
+    vertices    = numVertices > 0 ? (mapVertex_t*)lumps[MCL_VERTICES] : NULL;
+    sectors     = numSectors > 0 ? (mapSector_t*)lumps[MCL_SECTORS] : NULL;
+    faces       = numFaces > 0 ? (mapFace_t*)lumps[MCL_FACES] : NULL;
+    polys       = numPolys > 0 ? (mapPoly_t*)lumps[MCL_POLYS] : NULL;
+    texCoords   = numTCoords > 0 ? (mapTexCoords_t*)lumps[MCL_TEXCOORDS] : NULL;
+    events      = numEvents > 0 ? (mapEvent_t*)lumps[MCL_EVENTS] : NULL;
+
+    for(unsigned int i = 0; i < numFaces; ++i)
+    {
+        mapFace_t *f = &faces[i];
+
+        for(int j = 0; j < 4; ++j)
+        {
+            f->edges[j].v1 = &vertices[f->vertexStart+j].origin;
+            f->edges[j].v2 = &vertices[f->vertexStart+((j+1)&3)].origin;
+        }
+
+        if(f->flags & FF_PORTAL && f->sector >= 0)
+        {
+            numPortals++;
+        }
+    }
+
+    for(unsigned int i = 0; i < numSectors; ++i)
+    {
+        mapSector_t *s = &sectors[i];
+
+        s->objectThinker    = NULL;
+        s->ceilingFace      = &faces[s->faceEnd+1];
+        s->floorFace        = &faces[s->faceEnd+2];
+
+        s->actorList.Reset();
+        s->bufferIndex.Init();
+    }
+
+    BuildPortals(numPortals);
+    return true;
+}
+
+//
+// kexWorld::SaveMapCache
+//
+// Written right after the sectors are fully set up, before
+// anything gets spawned into them
+//
+
+void kexWorld::SaveMapCache(void)
+{
+    const void *lumpData[NUMMAPCACHELUMPS];
+    uint lumpSizes[NUMMAPCACHELUMPS];
+
+    lumpData[MCL_VERTICES]  = vertices;
+    lumpData[MCL_SECTORS]   = sectors;
+    lumpData[MCL_FACES]     = faces;
+    lumpData[MCL_POLYS]     = polys;
+    lumpData[MCL_TEXCOORDS] = texCoords;
+    lumpData[MCL_EVENTS]    = events;
+
+    lumpSizes[MCL_VERTICES]     = sizeof(mapVertex_t) * numVertices;
+    lumpSizes[MCL_SECTORS]      = sizeof(mapSector_t) * numSectors;
+    lumpSizes[MCL_FACES]        = sizeof(mapFace_t) * numFaces;
+    lumpSizes[MCL_POLYS]        = sizeof(mapPoly_t) * numPolys;
+    lumpSizes[MCL_TEXCOORDS]    = sizeof(mapTexCoords_t) * numTCoords;
+    lumpSizes[MCL_EVENTS]       = sizeof(mapEvent_t) * numEvents;
+
+    WriteMapCache(".kmc", MAPCACHE_VERSION, lumpData, lumpSizes, NUMMAPCACHELUMPS);
+}
+
+//
+// kexWorld::LoadMap
+//
+
+bool kexWorld::LoadMap(const char *mapname)
+{
+    kexBinFile mapfile;
+    int counts[8];
+    bool bCached;
+
+    bMapLoaded = false;
+
+    if(!mapfile.Open(mapname))
+    {
+        kex::cSystem->Warning("kexWorld::LoadMap - %s not found\n", mapname);
+        return false;
+    }
+
+    if(!mapfile.ReadArray(counts, 8))
+    {
+        kex::cSystem->Warning("kexWorld::LoadMap - %s is truncated\n", mapname);
+        return false;
+    }
+
+    numTextures     = counts[0];
+    numVertices     = counts[1];
+    numSectors      = counts[2];
+    numFaces        = counts[3];
+    numPolys        = counts[4];
+    numTCoords      = counts[5];
+    numEvents       = counts[6];
+    numActors       = counts[7];
+
+    // bail out before allocating anything for counts the file can't hold
+    if((uint64_t)(mapfile.Length() - mapfile.BufferOffset()) <
+        (uint64_t)numVertices * MAPREC_VERTEX_SIZE + (uint64_t)numSectors * MAPREC_SECTOR_SIZE +
+        (uint64_t)numFaces * MAPREC_FACE_SIZE + (uint64_t)numPolys * MAPREC_POLY_SIZE +
+        (uint64_t)numTCoords * MAPREC_TCOORD_SIZE + (uint64_t)numEvents * MAPREC_EVENT_SIZE +
+        (uint64_t)numActors * MAPREC_ACTOR_SIZE)
+    {
+        kex::cSystem->Warning("kexWorld::LoadMap - %s is truncated\n", mapname);
+        return false;
+    }
+
+    mapName = mapname;
+    mapSize = mapfile.Length();
+    mapHash = HashMapData(mapfile.Buffer(), mapSize);
+
+    if((bCached = LoadMapCache()))
+    {
+        kex::cSystem->DPrintf("kexWorld::LoadMap - Using cached data for %s\n", mapname);
+    }
+
+    if(numTextures  > 0) textures  = (kexTexture**)   Mem_Malloc(sizeof(kexTexture*) * numTextures, hb_world);
+    if(numActors    > 0) actors    = (mapActor_t*)    Mem_Malloc(sizeof(mapActor_t) * numActors, hb_world);
+
+    if(!bCached)
+    {
+        if(numVertices  > 0) vertices  = (mapVertex_t*)   Mem_Malloc(sizeof(mapVertex_t) * numVertices, hb_world);
+        if(numSectors   > 0) sectors   = (mapSector_t*)   Mem_Malloc(sizeof(mapSector_t) * numSectors, hb_world);
+        if(numFaces     > 0) faces     = (mapFace_t*)     Mem_Malloc(sizeof(mapFace_t) * numFaces, hb_world);
+        if(numPolys     > 0) polys     = (mapPoly_t*)     Mem_Malloc(sizeof(mapPoly_t) * numPolys, hb_world);
+        if(numTCoords   > 0) texCoords = (mapTexCoords_t*)Mem_Malloc(sizeof(mapTexCoords_t) * numTCoords, hb_world);
+        if(numEvents    > 0) events    = (mapEvent_t*)    Mem_Malloc(sizeof(mapEvent_t) * numEvents, hb_world);
+    }
+
+    if(numFaces > 0)
+    {
+        facePlanes  = (kexPlane*)Mem_Malloc(sizeof(kexPlane) * numFaces, hb_world);
+        faceBounds  = (kexBBox*) Mem_Malloc(sizeof(kexBBox) * numFaces, hb_world);
+        faceFlags   = (uint*)    Mem_Malloc(sizeof(uint) * numFaces, hb_world);
+        faceSectors = (short*)   Mem_Malloc(sizeof(short) * numFaces, hb_world);
+    }
+
+    ReadTextures(mapfile, numTextures);
+
+    if(bCached)
+    {
+        // skip straight to the actors
+        mapfile.ReadBlock(1, numVertices * MAPREC_VERTEX_SIZE + numSectors * MAPREC_SECTOR_SIZE +
+                             numFaces * MAPREC_FACE_SIZE + numPolys * MAPREC_POLY_SIZE +
+                             numTCoords * MAPREC_TCOORD_SIZE + numEvents * MAPREC_EVENT_SIZE);
+    }
+    else
+    {
+        ReadVertices(mapfile, numVertices);
+        ReadSectors(mapfile, numSectors);
+        ReadFaces(mapfile, numFaces);
+        ReadPolys(mapfile, numPolys);
+        ReadTexCoords(mapfile, numTCoords);
+        ReadEvents(mapfile, numEvents);
+    }
+
+    if(mapfile.Overrun())
+    {
+        kex::cSystem->Warning("kexWorld::LoadMap - %s is truncated\n", mapname);
+        UnloadMap();
+        return false;
+    }
+    
+    BuildAreaNodes();
+
+    if(!bCached)
+    {
+        BuildSectorBounds();
+        SetupEdges();
+        SaveMapCache();
+    }
+
+    BuildFaceHotData();
+    BuildSectorPVS();
+    SpawnEventMovers();
+    kexGame::cLocal->CModel()->Setup(this);
+    
+    ReadActors(mapfile, numActors);
+
+    bMapLoaded = true;
+
+    if(mapfile.Overrun())
+    {
+        kex::cSystem->Warning("kexWorld::LoadMap - %s is truncated\n", mapname);
+        UnloadMap();
+        return false;
+    }
+
+    return true;
+}
+
+//
+// kexWorld::BuildPrefetchManifest
+//
+// Collects everything a map will pull out of the pak files on load: the
+// map itself, its textures (including animated frames) and the sounds
+// referenced by the definitions of the actors placed in it
+//
+
+void kexWorld::BuildPrefetchManifest(const char *mapname, kexStrList &files)
+{
+    static const char *soundKeys[] =
+    {
+        "painSound",
+        "sightSound",
+        "pickupSound",
+        "bounceSound_1",
+        "bounceSound_2",
+        "bounceSound_3",
+        NULL
+    };
+
+    kexBinFile mapfile;
+    unsigned int counts[8];
+    unsigned int offset;
+    kexStr str;
+
+    if(!mapfile.Open(mapname))
+    {
+        return;
+    }
+
+    files.Push(mapname);
+
+    for(int i = 0; i < 8; ++i)
+    {
+        counts[i] = mapfile.Read32();
+    }
+
+    // sky texture followed by the wall textures
+    for(unsigned int i = 0; counts[0] > 0 && i <= counts[0]; ++i)
+    {
+        int len = mapfile.Read16();
+        kexDict *dict;
+
+        if(len <= 0)
+        {
+            mapfile.Read16();
+            continue;
+        }
+
+        str = "";
+
+        for(int j = 0; j < len; ++j)
+        {
+            str += (char)mapfile.Read8();
+        }
+
+        files.Push(str);
+
+        if(i == 0 || !(dict = kexGame::cLocal->AnimPicDefs().GetEntry(str.c_str())))
+        {
+            continue;
+        }
+
+        for(int idx = 1; dict->GetString(kexStr::Format("texture_%i", idx), str); ++idx)
+        {
+            files.Push(str);
         }
     }
-}
 
-//
-// kexWorld::SpawnMapActor
-//
+    // skip over the geometry to the actors
+    offset = mapfile.BufferOffset() +
+        counts[1] * MAPREC_VERTEX_SIZE + counts[2] * MAPREC_SECTOR_SIZE +
+        counts[3] * MAPREC_FACE_SIZE + counts[4] * MAPREC_POLY_SIZE +
+        counts[5] * MAPREC_TCOORD_SIZE + counts[6] * MAPREC_EVENT_SIZE;
 
-void kexWorld::SpawnMapActor(mapActor_t *mapActor)
-{
-    float x, y, z;
-    float an;
-    kexActor *actor;
-    
-    if(mapActor->type <= -1)
+    if(offset + counts[7] * MAPREC_ACTOR_SIZE > (unsigned int)mapfile.Length())
     {
         return;
     }
-    
-    x   = (float)mapActor->x;
-    y   = (float)mapActor->y;
-    z   = (float)mapActor->z;
-    an  = kexMath::Deg2Rad((360 - (float)mapActor->angle) + 90);
-    
-    actor = kexGame::cActorFactory->Spawn(mapActor->type, x, y, z, an, mapActor->sector);
 
-    if(!actor)
+    for(unsigned int i = 0; i < counts[7]; ++i)
     {
-        return;
-    }
+        kexDict *def;
 
-    actor->SetMapActor(mapActor);
+        mapfile.SetPosition(offset + i * MAPREC_ACTOR_SIZE);
+
+        if(!(def = kexGame::cLocal->ActorDefs().GetEntry(mapfile.Read16())))
+        {
+            continue;
+        }
+
+        for(int j = 0; soundKeys[j]; ++j)
+        {
+            if(def->GetString(soundKeys[j], str) && !files.Contains(str))
+            {
+                files.Push(str);
+            }
+        }
+    }
 }
 
 //
-// kexWorld::LoadMap
+// kexWorld::PrefetchMap
+//
+// Queues up the map's files on the pak worker threads so they are
+// read and inflated while the current map is fading out
 //
 
-bool kexWorld::LoadMap(const char *mapname)
+void kexWorld::PrefetchMap(const char *mapname)
 {
-    kexBinFile mapfile;
-
-    bMapLoaded = false;
+    kexStrList *manifest;
 
-    if(!mapfile.Open(mapname))
+    if(kexStr::Compare(prefetchedMap.c_str(), mapname))
     {
-        kex::cSystem->Warning("kexWorld::LoadMap - %s not found\n", mapname);
-        return false;
+        // drop whatever was fetched for a map that we never went to
+        kex::cPakFiles->FlushPrefetches();
+        prefetchedMap = mapname;
     }
 
-    numTextures     = mapfile.Read32();
-    numVertices     = mapfile.Read32();
-    numSectors      = mapfile.Read32();
-    numFaces        = mapfile.Read32();
-    numPolys        = mapfile.Read32();
-    numTCoords      = mapfile.Read32();
-    numEvents       = mapfile.Read32();
-    numActors       = mapfile.Read32();
+    if(!(manifest = prefetchManifests.Find(mapname)))
+    {
+        manifest = prefetchManifests.Add(mapname);
+        BuildPrefetchManifest(mapname, *manifest);
+    }
 
-    if(numTextures  > 0) textures  = (kexTexture**)   Mem_Malloc(sizeof(kexTexture*) * numTextures, hb_world);
-    if(numVertices  > 0) vertices  = (mapVertex_t*)   Mem_Malloc(sizeof(mapVertex_t) * numVertices, hb_world);
-    if(numSectors   > 0) sectors   = (mapSector_t*)   Mem_Malloc(sizeof(mapSector_t) * numSectors, hb_world);
-    if(numFaces     > 0) faces     = (mapFace_t*)     Mem_Malloc(sizeof(mapFace_t) * numFaces, hb_world);
-    if(numPolys     > 0) polys     = (mapPoly_t*)     Mem_Malloc(sizeof(mapPoly_t) * numPolys, hb_world);
-    if(numTCoords   > 0) texCoords = (mapTexCoords_t*)Mem_Malloc(sizeof(mapTexCoords_t) * numTCoords, hb_world);
-    if(numEvents    > 0) events    = (mapEvent_t*)    Mem_Malloc(sizeof(mapEvent_t) * numEvents, hb_world);
-    if(numActors    > 0) actors    = (mapActor_t*)    Mem_Malloc(sizeof(mapActor_t) * numActors, hb_world);
+    for(unsigned int i = 0; i < manifest->Length(); ++i)
+    {
+        const char *file = (*manifest)[i].c_str();
 
-    ReadTextures(mapfile, numTextures);
-    ReadVertices(mapfile, numVertices);
-    ReadSectors(mapfile, numSectors);
-    ReadFaces(mapfile, numFaces);
-    ReadPolys(mapfile, numPolys);
-    ReadTexCoords(mapfile, numTCoords);
-    ReadEvents(mapfile, numEvents);
-    
-    BuildAreaNodes();
-    BuildSectorBounds();
-    SetupEdges();
-    kexGame::cLocal->CModel()->Setup(this);
-    
-    ReadActors(mapfile, numActors);
+        if(kexRender::cTextures->IsCached(file) || kex::cSound->IsCached(file))
+        {
+            continue;
+        }
 
-    bMapLoaded = true;
-    return true;
+        kex::cPakFiles->OpenFileAsync(file);
+    }
 }
 
 //
@@ -735,6 +2243,13 @@ void kexWorld::UnloadMap(void)
     
     kexGame::cLocal->CModel()->Reset();
     Mem_Purge(hb_world);
+    mapCache.Close();
+    sectorVis = NULL;
+
+    for(int i = 0; i < MAX_SECTORWALKS; ++i)
+    {
+        sectorWalks[i].Reset();
+    }
 }
 
 //
@@ -770,7 +2285,7 @@ void kexWorld::UpdateAnimPics(void)
 // kexWorld::SetupFloatingPlatforms
 //
 
-void kexWorld::SetupFloatingPlatforms(mapEvent_t *ev, mapSector_t *sector, const char *className)
+void kexWorld::SetupFloatingPlatforms(mapEvent_t *ev, mapSector_t *sector)
 {
     mapSector_t *s;
 
@@ -781,7 +2296,6 @@ void kexWorld::SetupFloatingPlatforms(mapEvent_t *ev, mapSector_t *sector, const
 
     s = &sectors[ev->sector];
     s->linkedSector = ev->params;
-    s->objectThinker = kexGame::cActorFactory->SpawnMover(className, ev->type, ev->sector);
 }
 
 //
@@ -1036,19 +2550,16 @@ void kexWorld::MoveSector(mapSector_t *sector, bool bCeiling, const float moveAm
 float kexWorld::GetHighestSurroundingFloor(mapSector_t *sector)
 {
     float height = (float)sector->floorHeight;
+    const int secnum = sector - sectors;
+    mapPortal_t *portal = SectorPortals(secnum);
 
-    for(int i = sector->faceStart; i < sector->faceEnd+3; ++i)
+    for(uint i = 0; i < NumSectorPortals(secnum); ++i, ++portal)
     {
-        mapFace_t *face = &faces[i];
-        
-        if(face->flags & FF_PORTAL && face->sector >= 0)
-        {
-            mapSector_t *s = &sectors[face->sector];
+        mapSector_t *s = &sectors[portal->sector];
 
-            if((float)s->floorHeight > height)
-            {
-                height = (float)s->floorHeight;
-            }
+        if((float)s->floorHeight > height)
+        {
+            height = (float)s->floorHeight;
         }
     }
 
@@ -1067,19 +2578,16 @@ float kexWorld::GetHighestSurroundingFloor(mapSector_t *sector)
 float kexWorld::GetLowestSurroundingFloor(mapSector_t *sector)
 {
     float height = faces[sector->faceEnd+2].plane.d;
+    const int secnum = sector - sectors;
+    mapPortal_t *portal = SectorPortals(secnum);
 
-    for(int i = sector->faceStart; i < sector->faceEnd+3; ++i)
+    for(uint i = 0; i < NumSectorPortals(secnum); ++i, ++portal)
     {
-        mapFace_t *face = &faces[i];
-        
-        if(face->flags & FF_PORTAL && face->sector >= 0)
-        {
-            mapSector_t *s = &sectors[face->sector];
+        mapSector_t *s = &sectors[portal->sector];
 
-            if((float)s->floorHeight < height)
-            {
-                height = (float)s->floorHeight;
-            }
+        if((float)s->floorHeight < height)
+        {
+            height = (float)s->floorHeight;
         }
     }
 
@@ -1521,6 +3029,7 @@ void kexWorld::TeleportEvent(kexActor *actor, mapEvent_t *event)
 
         actor->Origin() = org;
         actor->SetSector(&sectors[ev->sector]);
+        actor->LinkArea();
 
         // player hack
         if(actor->InstanceOf(&kexPuppet::info))
@@ -1707,6 +3216,8 @@ void kexWorld::ExplodeWall(mapFace_t *face)
 
     face->flags &= ~(FF_SOLID|FF_TOGGLE);
     face->flags |= FF_PORTAL;
+    UpdateFaceHotData(face);
+    LinkSectorPortal(face);
 
     for(int j = face->polyStart; j <= face->polyEnd; ++j)
     {
@@ -1747,9 +3258,12 @@ void kexWorld::ExplodeWall(mapFace_t *face)
 
 void kexWorld::ExplodeWallEvent(mapSector_t *sector)
 {
-    for(int i = sector->faceStart; i < sector->faceEnd+3; ++i)
+    const int secnum = sector - sectors;
+    int *toggles = SectorToggleFaces(secnum);
+
+    for(uint i = 0; i < NumSectorToggleFaces(secnum); ++i)
     {
-        mapFace_t *face = &faces[i];
+        mapFace_t *face = &faces[toggles[i]];
 
         if(!(face->flags & FF_TOGGLE))
         {
@@ -1777,17 +3291,36 @@ void kexWorld::ExplodeWallEvent(mapSector_t *sector)
 // kexWorld::CheckActorsForRadialBlast
 //
 
-void kexWorld::CheckActorsForRadialBlast(mapSector_t *sector, kexActor *source, const kexVec3 &origin,
+void kexWorld::CheckActorsForRadialBlast(kexActor *source, const kexVec3 &origin,
                                          const float radius, const int damage, bool bCanIgnite)
 {
+    kexActor *localActors[512];
+    kexArray<kexActor*> moreActors;
+    kexActor **actors = localActors;
+    unsigned int count;
     kexVec3 end;
     float dist;
     float dmgAmount;
+
+    count = areaNodes.QueryRadius(origin, radius, actors, 512);
+
+    if(count > 512)
+    {
+        // too many for the local list so query again into one that fits
+        moreActors.Resize(count);
+        actors = &moreActors[0];
+        count = areaNodes.QueryRadius(origin, radius, actors, moreActors.Length());
+
+        if(count > moreActors.Length())
+        {
+            count = moreActors.Length();
+        }
+    }
     
-    for(kexActor *actor = sector->actorList.Next();
-        actor != NULL;
-        actor = actor->SectorLink().Next())
+    for(unsigned int i = 0; i < count; ++i)
     {
+        kexActor *actor = actors[i];
+
         if(actor == source)
         {
             // don't check self
@@ -1807,8 +3340,18 @@ void kexWorld::CheckActorsForRadialBlast(mapSector_t *sector, kexActor *source,
             continue;
         }
         
-        if(source->Sector() != sector)
+        if(actor->IsStale() || actor->Sector() == NULL)
+        {
+            continue;
+        }
+        
+        if(source->Sector() != actor->Sector())
         {
+            if(!SectorPotentiallyVisible(source->Sector() - sectors, actor->Sector() - sectors))
+            {
+                continue;
+            }
+
             if(!kexGame::cLocal->CModel()->Trace(source, source->Sector(), origin, end))
             {
                 continue;
@@ -1834,6 +3377,31 @@ void kexWorld::CheckActorsForRadialBlast(mapSector_t *sector, kexActor *source,
     }
 }
 
+//
+// RadialDamageEdge
+//
+
+typedef struct
+{
+    uint                *faceFlags;
+    kexBBox             bounds;
+} radialWalk_t;
+
+static walkEdge_t RadialDamageEdge(kexSectorWalk *walk, mapSector_t *from, mapSector_t *next,
+                                   const mapPortal_t *portal, void *data)
+{
+    radialWalk_t *radial = (radialWalk_t*)data;
+
+    if(radial->faceFlags[portal->face] & FF_SOLID || walk->IsMarked(next))
+    {
+        return WALK_SKIP;
+    }
+
+    // sectors outside of the blast are still marked so they
+    // aren't tested again through another portal
+    return radial->bounds.IntersectingBox(next->bounds) ? WALK_ENTER : WALK_MARK;
+}
+
 //
 // kexWorld::RadialDamage
 //
@@ -1846,91 +3414,92 @@ void kexWorld::RadialDamage(kexActor *source, const float radius, const int dama
         return;
     }
     
-    unsigned int scanCount = 0;
     kexVec3 start = source->Origin() + kexVec3(0, 0, source->Height() * 0.5f);
-    kexBBox bounds;
-    
-    bounds.min.Set(-(radius*0.5f));
-    bounds.max.Set( (radius*0.5f));
-    bounds.min += start;
-    bounds.max += start;
+    kexSectorWalk *walk;
+    mapSector_t *sector;
+    radialWalk_t radial;
     
-    scanSectors.Reset();
-    scanSectors.Set(source->Sector());
-    source->Sector()->floodCount = 1;
+    radial.faceFlags = faceFlags;
+    radial.bounds.min.Set(-(radius*0.5f));
+    radial.bounds.max.Set( (radius*0.5f));
+    radial.bounds.min += start;
+    radial.bounds.max += start;
     
-    memset(pvsMask, 0, pvsSize);
-    MarkSectorInPVS(source->Sector() - sectors);
+    CheckActorsForRadialBlast(source, start, radius, damage, bCanDestroyWalls);
     
-    CheckActorsForRadialBlast(source->Sector(), source, start, radius, damage, bCanDestroyWalls);
+    walk = AcquireWalk();
+    walk->Start(source->Sector());
     
-    do
+    while((sector = walk->Next()) != NULL)
     {
-        mapSector_t *sector = scanSectors[scanCount++];
         bool bWallsDestroyed = false;
-        
-        if(sector->floodCount == 0)
-        {
-            continue;
-        }
-        
-        sector->floodCount = 0;
+        const int secnum = sector - sectors;
 
-        for(int i = sector->faceStart; i < sector->faceEnd+3; ++i)
-        {
-            mapFace_t *face = &faces[i];
+        walk->WalkPortals(sector, RadialDamageEdge, &radial);
 
-            if(face->flags & FF_SOLID)
-            {
-                if(!(face->flags & FF_PORTAL))
-                {
-                    if( face->sector >= 0 && face->flags & FF_TOGGLE && bCanDestroyWalls &&
-                        face->plane.Distance(start) < (radius * 0.5f))
-                    {
-                        mapSector_t *s = &sectors[face->sector];
+        // a force field that was switched off still lets the blast through
+        // even though it never becomes a portal
+        int *passages = SectorPassageFaces(secnum);
 
-                        ExplodeWall(face);
+        for(uint i = 0; i < NumSectorPassageFaces(secnum); ++i)
+        {
+            mapSector_t *next = &sectors[faceSectors[passages[i]]];
 
-                        for(int j = s->faceStart; j < s->faceEnd+3; ++j)
-                        {
-                            mapFace_t *f = &faces[j];
+            if(faceFlags[passages[i]] & FF_SOLID || walk->IsMarked(next))
+            {
+                continue;
+            }
 
-                            if(!(f->flags & FF_TOGGLE))
-                            {
-                                continue;
-                            }
+            if(radial.bounds.IntersectingBox(next->bounds))
+            {
+                walk->Enter(next);
+            }
+            else
+            {
+                walk->Mark(next);
+            }
+        }
 
-                            if(f->sector != face->sectorOwner)
-                            {
-                                continue;
-                            }
+        if(bCanDestroyWalls)
+        {
+            int *toggles = SectorToggleFaces(secnum);
 
-                            ExplodeWall(f);
-                        }
+            for(uint i = 0; i < NumSectorToggleFaces(secnum); ++i)
+            {
+                const int f = toggles[i];
+                const uint flags = faceFlags[f];
+                const int facesec = faceSectors[f];
 
-                        bWallsDestroyed = true;
-                    }
+                if(!(flags & FF_TOGGLE) || !(flags & FF_SOLID) || flags & FF_PORTAL || facesec <= -1)
+                {
+                    continue;
                 }
-                continue;
-            }
-            
-            if(face->sector >= 0)
-            {
-                mapSector_t *next = &sectors[face->sector];
-                
-                if(SectorInPVS(face->sector))
+
+                if(facePlanes[f].Distance(start) >= (radius * 0.5f))
                 {
                     continue;
                 }
-                
-                CheckActorsForRadialBlast(next, source, start, radius, damage, bCanDestroyWalls);
-                MarkSectorInPVS(face->sector);
-                
-                if(bounds.IntersectingBox(next->bounds))
+
+                int *sToggles = SectorToggleFaces(facesec);
+
+                ExplodeWall(&faces[f]);
+
+                for(uint j = 0; j < NumSectorToggleFaces(facesec); ++j)
                 {
-                    next->floodCount = 1;
-                    scanSectors.Set(next);
+                    if(!(faceFlags[sToggles[j]] & FF_TOGGLE))
+                    {
+                        continue;
+                    }
+
+                    if(faceSectors[sToggles[j]] != secnum)
+                    {
+                        continue;
+                    }
+
+                    ExplodeWall(&faces[sToggles[j]]);
                 }
+
+                bWallsDestroyed = true;
             }
         }
 
@@ -1940,8 +3509,40 @@ void kexWorld::RadialDamage(kexActor *source, const float radius, const int dama
             SendRemoteTrigger(sector, &events[sector->event]);
             sector->event = -1;
         }
-        
-    } while(scanCount < scanSectors.CurrentLength());
+    }
+    
+    ReleaseWalk(walk);
+}
+
+//
+// FloodFillEdge
+//
+
+typedef struct
+{
+    kexCModel           *cmodel;
+    mapFace_t           *faces;
+    kexVec3             start;
+    float               maxDistance;
+} floodWalk_t;
+
+static walkEdge_t FloodFillEdge(kexSectorWalk *walk, mapSector_t *from, mapSector_t *next,
+                                const mapPortal_t *portal, void *data)
+{
+    floodWalk_t *flood = (floodWalk_t*)data;
+    float d = flood->cmodel->PointOnFaceSide(flood->start, &flood->faces[portal->face]);
+
+    if(d <= 0)
+    {
+        return WALK_SKIP;
+    }
+
+    if(d >= flood->maxDistance)
+    {
+        return WALK_STOP;
+    }
+
+    return walk->IsMarked(next) ? WALK_SKIP : WALK_ENTER;
 }
 
 //
@@ -1950,104 +3551,163 @@ void kexWorld::RadialDamage(kexActor *source, const float radius, const int dama
 
 sectorList_t *kexWorld::FloodFill(const kexVec3 &start, mapSector_t *sector, const float maxDistance)
 {
-    unsigned int scanCount = 0;
+    kexSectorWalk *walk;
+    floodWalk_t flood;
 
     if(sector == NULL)
     {
         return NULL;
     }
 
-    scanSectors.Reset();
-    scanSectors.Set(sector);
-    sector->floodCount = 1;
+    flood.cmodel = kexGame::cLocal->CModel();
+    flood.faces = faces;
+    flood.start = start;
+    flood.maxDistance = maxDistance;
 
-    memset(pvsMask, 0, pvsSize);
-    MarkSectorInPVS(sector - sectors);
+    walk = AcquireWalk();
+    walk->Start(sector, &scanSectors);
 
-    do
+    while((sector = walk->Next()) != NULL)
     {
-        mapSector_t *sec = scanSectors[scanCount++];
-        
-        if(sec->floodCount == 0)
-        {
-            continue;
-        }
-        
-        sec->floodCount = 0;
+        walk->WalkPortals(sector, FloodFillEdge, &flood);
+    }
 
-        for(int i = sec->faceStart; i < sec->faceEnd+3; ++i)
-        {
-            mapFace_t *face = &faces[i];
-            float d;
+    ReleaseWalk(walk);
+    return &scanSectors;
+}
 
-            if(!(face->flags & FF_PORTAL) || face->sector <= -1)
-            {
-                continue;
-            }
+//
+// kexSectorWalk::kexSectorWalk
+//
 
-            d = kexGame::cLocal->CModel()->PointOnFaceSide(start, face);
+kexSectorWalk::kexSectorWalk(void)
+{
+    this->world         = NULL;
+    this->sectors       = NULL;
+    this->numSectors    = 0;
+    this->generation    = 0;
+    this->marks         = NULL;
+    this->entered       = NULL;
+    this->queued        = NULL;
+    this->head          = 0;
+    this->list          = &queue;
+}
 
-            if(d <= 0)
-            {
-                continue;
-            }
+//
+// kexSectorWalk::Init
+//
 
-            if(d >= maxDistance)
-            {
-                break;
-            }
+void kexSectorWalk::Init(kexWorld *world, mapSector_t *sectors, const uint numSectors,
+                         kexHeapBlock &hb)
+{
+    this->world         = world;
+    this->sectors       = sectors;
+    this->numSectors    = numSectors;
+    this->generation    = 0;
+    this->head          = 0;
+    this->list          = &queue;
+
+    marks   = (uint*)Mem_Calloc(sizeof(uint) * (numSectors+1), hb);
+    entered = (uint*)Mem_Calloc(sizeof(uint) * (numSectors+1), hb);
+    queued  = (uint*)Mem_Calloc(sizeof(uint) * (numSectors+1), hb);
+}
 
-            mapSector_t *next = &sectors[face->sector];
-                
-            if(SectorInPVS(face->sector))
-            {
-                continue;
-            }
-            
-            MarkSectorInPVS(face->sector);
-            
-            next->floodCount = 1;
-            scanSectors.Set(next);
-        }
+//
+// kexSectorWalk::Reset
+//
+// Drops the mark arrays when the map heap is purged
+//
 
-    } while(scanCount < scanSectors.CurrentLength());
+void kexSectorWalk::Reset(void)
+{
+    world       = NULL;
+    sectors     = NULL;
+    numSectors  = 0;
+    marks       = NULL;
+    entered     = NULL;
+    queued      = NULL;
+    head        = 0;
+    list        = &queue;
+
+    queue.Reset();
+}
 
-    return &scanSectors;
+//
+// kexSectorWalk::Start
+//
+// Begins a new walk from sector, queuing into list if one is
+// given. Bumping the generation is what clears the previous
+// walk's marks; the arrays only get wiped when it wraps around
+//
+
+void kexSectorWalk::Start(mapSector_t *sector, sectorList_t *list)
+{
+    if(++generation == 0)
+    {
+        memset(marks, 0, sizeof(uint) * numSectors);
+        memset(entered, 0, sizeof(uint) * numSectors);
+        memset(queued, 0, sizeof(uint) * numSectors);
+        generation = 1;
+    }
+
+    this->list = (list != NULL) ? list : &queue;
+    this->list->Reset();
+    head = 0;
+
+    Enter(sector);
 }
 
 //
-// kexWorld::ClearSectorPVS
+// kexSectorWalk::Next
+//
+// Pops the next queued sector. Returns NULL once the
+// queue has been drained
 //
 
-void kexWorld::ClearSectorPVS(void)
+mapSector_t *kexSectorWalk::Next(void)
 {
-    memset(pvsMask, 0, pvsSize);
+    mapSector_t *sector;
+
+    if(head >= list->CurrentLength())
+    {
+        return NULL;
+    }
+
+    sector = (*list)[head++];
+    queued[sector - sectors] = 0;
+
+    return sector;
 }
 
 //
-// kexWorld::MarkSectorInPVS
+// kexWorld::AcquireWalk
+//
+// Walks must be released in the reverse order they
+// were acquired
 //
 
-void kexWorld::MarkSectorInPVS(const int secnum)
+kexSectorWalk *kexWorld::AcquireWalk(void)
 {
-    if(secnum <= -1)
+    if(numActiveWalks >= MAX_SECTORWALKS)
     {
-        return;
+        kex::cSystem->Error("kexWorld::AcquireWalk: sector walks nested too deep\n");
+        return NULL;
     }
 
-    pvsMask[secnum >> 3] |= (1 << (secnum & 7));
+    return &sectorWalks[numActiveWalks++];
 }
 
 //
-// kexWorld::SectorInPVS
+// kexWorld::ReleaseWalk
 //
 
-bool kexWorld::SectorInPVS(const int secnum)
+void kexWorld::ReleaseWalk(kexSectorWalk *walk)
 {
-    if(secnum <= -1)
+    if(numActiveWalks <= 0 || walk != &sectorWalks[numActiveWalks-1])
     {
-        return false;
+        kex::cSystem->Error("kexWorld::ReleaseWalk: sector walk released out of order\n");
+        return;
     }
 
-    return (pvsMask[secnum >> 3] & (1 << (secnum & 7))) != 0;
+    numActiveWalks--;
 }
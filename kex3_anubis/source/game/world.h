@@ -22,6 +22,7 @@ class kexActor;
 class kexTexture;
 class kexCModel;
 class kexGameObject;
+class kexWorld;
 
 typedef struct
 {
@@ -62,7 +63,6 @@ typedef struct
     word                    flags;
     kexBBox                 bounds;
     int                     event;
-    int                     validcount;
     int                     floodCount;
     int                     clipCount;
     float                   x1;
@@ -102,6 +102,9 @@ typedef enum
     FF_UPDATED          = BIT(17)
 } faceFlags_t;
 
+// face flags mirrored into kexWorld::FaceFlags
+#define FF_HOTFLAGS     (FF_SOLID|FF_WATER|FF_TOGGLE|FF_FORCEFIELD|FF_PORTAL)
+
 typedef enum
 {
     EGF_TOPSTEP         = BIT(0),
@@ -184,6 +187,34 @@ typedef struct
     float               angle;
 } mapActor_t;
 
+typedef struct
+{
+    int                 face;
+    int                 sector;
+} mapPortal_t;
+
+#define MAX_MAPCACHE_LUMPS  8
+
+typedef struct
+{
+    uint                offset;
+    uint                length;
+} mapCacheLump_t;
+
+//
+// header shared by all on-disk caches derived from a map. every lump
+// starts 16 byte aligned so the file can be mapped and used in place
+//
+typedef struct
+{
+    char                ident[4];
+    int                 version;
+    uint                mapHash;
+    uint                mapSize;
+    uint                numLumps;
+    mapCacheLump_t      lumps[MAX_MAPCACHE_LUMPS];
+} mapCacheHeader_t;
+
 typedef struct
 {
     float               speed;
@@ -193,6 +224,85 @@ typedef struct
     kexTexture          **textures;
 } animPic_t;
 
+#define MAX_SECTORWALKS     8
+
+typedef enum
+{
+    WALK_SKIP   = 0,    // ignore the neighboring sector
+    WALK_MARK,          // mark it as seen without entering it
+    WALK_ENTER,         // mark it and queue it up
+    WALK_STOP           // skip the rest of this sector's portals
+} walkEdge_t;
+
+class kexSectorWalk;
+
+typedef walkEdge_t (*walkEdgeFunc_t)(kexSectorWalk *walk, mapSector_t *from, mapSector_t *next,
+                                     const mapPortal_t *portal, void *data);
+
+//
+// breadth-first walk over the sector graph. sectors are stamped with
+// the walk's generation instead of having their marks cleared before
+// every flood, and walks are handed out by kexWorld::AcquireWalk in
+// stack order so a trace can run in the middle of another flood
+//
+class kexSectorWalk
+{
+public:
+    kexSectorWalk(void);
+
+    void                    Init(kexWorld *world, mapSector_t *sectors, const uint numSectors,
+                                 kexHeapBlock &hb);
+    void                    Reset(void);
+    void                    Start(mapSector_t *sector, sectorList_t *list = NULL);
+    mapSector_t             *Next(void);
+    d_inline void           WalkPortals(mapSector_t *sector, walkEdgeFunc_t edgeFunc, void *data);
+
+    d_inline bool           IsMarked(const mapSector_t *sector) const
+    {
+        return marks[sector - sectors] == generation;
+    }
+
+    d_inline bool           WasEntered(const mapSector_t *sector) const
+    {
+        return entered[sector - sectors] == generation;
+    }
+
+    d_inline void           Mark(const mapSector_t *sector)
+    {
+        marks[sector - sectors] = generation;
+    }
+
+    // queues the sector unless it's already waiting in the queue.
+    // a sector can be entered again after it has been walked
+    d_inline void           Enter(mapSector_t *sector)
+    {
+        const int secnum = sector - sectors;
+
+        marks[secnum] = generation;
+        entered[secnum] = generation;
+
+        if(queued[secnum] != generation)
+        {
+            queued[secnum] = generation;
+            list->Set(sector);
+        }
+    }
+
+    d_inline sectorList_t   &List(void) { return *list; }
+
+private:
+    kexWorld                *world;
+    mapSector_t             *sectors;
+    uint                    numSectors;
+    uint                    generation;
+    uint                    *marks;
+    uint                    *entered;
+    uint                    *queued;
+    uint                    head;
+    sectorList_t            *list;
+    sectorList_t            queue;
+};
+
 class kexWorld
 {
 public:
@@ -201,11 +311,14 @@ public:
 
     bool                    LoadMap(const char *mapname);
     void                    UnloadMap(void);
+    void                    PrefetchMap(const char *mapname);
     void                    RadialDamage(kexActor *source, const float radius, const int damage,
                                          const bool bCanDestroyWalls = true);
     sectorList_t            *FloodFill(const kexVec3 &start, mapSector_t *sector, const float maxDistance);
     void                    UpdateSectorBounds(mapSector_t *sector);
     void                    UpdateFacePlaneAndBounds(mapFace_t *face);
+    void                    UpdateFaceHotData(mapFace_t *face);
+    void                    LinkSectorPortal(mapFace_t *face);
     void                    EnterSectorSpecial(kexActor *actor, mapSector_t *sector);
     void                    UseWallSpecial(kexPlayer *player, mapFace_t *face);
     float                   GetHighestSurroundingFloor(mapSector_t *sector);
@@ -218,14 +331,32 @@ public:
     void                    SendRemoteTrigger(mapSector_t *sector, mapEvent_t *event);
     void                    MoveScriptedSector(const int tag, const float height,
                                                const float speed, const bool bCeiling);
-    void                    ClearSectorPVS(void);
-    void                    MarkSectorInPVS(const int secnum);
-    bool                    SectorInPVS(const int secnum);
+    kexSectorWalk           *AcquireWalk(void);
+    void                    ReleaseWalk(kexSectorWalk *walk);
+
+    // false only if nothing in sector 'to' can ever be seen from sector 'from'
+    d_inline bool           SectorPotentiallyVisible(const int from, const int to) const
+    {
+        if(sectorVis == NULL)
+        {
+            return true;
+        }
+
+        return (sectorVis[from * visRowSize + (to >> 3)] & BIT(to & 7)) != 0;
+    }
 
     void                    UpdateAnimPics(void);
 
+    bool                    OpenMapCache(kexBinFile &file, const char *ext, const int version,
+                                         const uint numLumps);
+    void                    WriteMapCache(const char *ext, const int version, const void **lumpData,
+                                          const uint *lumpSizes, const uint numLumps);
+    static byte             *MapCacheLump(kexBinFile &file, const uint lump, const uint size,
+                                          const uint count);
+
     const bool              MapLoaded(void) const { return bMapLoaded; }
 
+    d_inline const uint     NumTextures(void) const { return numTextures; }
     d_inline const uint     NumVertices(void) const { return numVertices; }
     d_inline const uint     NumSectors(void) const { return numSectors; }
     d_inline const uint     NumFaces(void) const { return numFaces; }
@@ -241,6 +372,29 @@ public:
     d_inline mapVertex_t    *Vertices(void) { return vertices; }
     d_inline mapSector_t    *Sectors(void) { return sectors; }
     d_inline mapFace_t      *Faces(void) { return faces; }
+    d_inline kexPlane       *FacePlanes(void) { return facePlanes; }
+    d_inline kexBBox        *FaceBounds(void) { return faceBounds; }
+    d_inline uint           *FaceFlags(void) { return faceFlags; }
+    d_inline short          *FaceSectors(void) { return faceSectors; }
+
+    // open portals leading out of a sector, in face order
+    d_inline mapPortal_t    *SectorPortals(const int secnum) { return &portals[portalStart[secnum]]; }
+    d_inline const uint     NumSectorPortals(const int secnum) const { return portalCount[secnum]; }
+
+    // breakable walls of a sector, whether or not they have been blown open
+    d_inline int            *SectorToggleFaces(const int secnum) { return &toggleFaces[toggleStart[secnum]]; }
+    d_inline const uint     NumSectorToggleFaces(const int secnum) const
+    {
+        return toggleStart[secnum+1] - toggleStart[secnum];
+    }
+
+    // linked faces that are not portals, such as force fields. the blast
+    // flood passes through them once they are no longer solid
+    d_inline int            *SectorPassageFaces(const int secnum) { return &passageFaces[passageStart[secnum]]; }
+    d_inline const uint     NumSectorPassageFaces(const int secnum) const
+    {
+        return passageStart[secnum+1] - passageStart[secnum];
+    }
     d_inline mapPoly_t      *Polys(void) { return polys; }
     d_inline mapTexCoords_t *TexCoords(void) { return texCoords; }
     d_inline mapEvent_t     *Events(void) { return events; }
@@ -250,10 +404,10 @@ public:
     kexSDNode<kexActor>     &AreaNodes(void) { return areaNodes; }
 
     static kexHeapBlock     hb_world;
+    static kexCvar          cvarMapCache;
 
 private:
-    void                    CheckActorsForRadialBlast(mapSector_t *sector, kexActor *source,
-                                                      const kexVec3 &origin,
+    void                    CheckActorsForRadialBlast(kexActor *source, const kexVec3 &origin,
                                                       const float radius, const int damage, bool bCanIgnite);
     void                    UseLockedDoor(kexPlayer *player, mapEvent_t *ev);
     void                    UseWallSwitch(kexPlayer *player, mapFace_t *face, mapEvent_t *ev);
@@ -268,7 +422,12 @@ private:
     void                    SetupEdges(void);
     void                    SpawnMapActor(mapActor_t *mapActor);
     void                    BuildPortals(unsigned int count);
-    void                    SetupFloatingPlatforms(mapEvent_t *ev, mapSector_t *sector, const char *className);
+    void                    BuildSectorGraph(void);
+    void                    BuildSectorPVS(void);
+    bool                    LoadSectorPVS(void);
+    void                    SaveSectorPVS(void);
+    static int              SectorPVSThread(void *data);
+    void                    SetupFloatingPlatforms(mapEvent_t *ev, mapSector_t *sector);
     bool                    EventIsASwitch(const int eventID);
     
     void                    ReadTextures(kexBinFile &mapfile, const unsigned int count);
@@ -279,9 +438,23 @@ private:
     void                    ReadTexCoords(kexBinFile &mapfile, const unsigned int count);
     void                    ReadEvents(kexBinFile &mapfile, const unsigned int count);
     void                    ReadActors(kexBinFile &mapfile, const unsigned int count);
+    void                    BuildPrefetchManifest(const char *mapname, kexStrList &files);
+    void                    SpawnEventMovers(void);
+    void                    BuildFaceHotData(void);
+    kexStr                  MapCachePath(const char *ext);
+    bool                    LoadMapCache(void);
+    void                    SaveMapCache(void);
 
     bool                    bMapLoaded;
 
+    kexHashList<kexStrList> prefetchManifests;
+    kexStr                  prefetchedMap;
+
+    kexStr                  mapName;
+    uint                    mapHash;
+    uint                    mapSize;
+    kexBinFile              mapCache;
+
     unsigned int            numTextures;
     unsigned int            numVertices;
     unsigned int            numSectors;
@@ -291,8 +464,9 @@ private:
     unsigned int            numEvents;
     unsigned int            numActors;
 
-    unsigned int            pvsSize;
-    byte                    *pvsMask;
+    // one row of visRowSize bytes per sector
+    unsigned int            visRowSize;
+    byte                    *sectorVis;
 
     unsigned int            portalsPassed;
 
@@ -307,8 +481,61 @@ private:
     mapActor_t              *actors;
     animPic_t               *animPics;
 
+    // parallel copies of the face fields the collision and
+    // visibility loops read for every face they scan
+    kexPlane                *facePlanes;
+    kexBBox                 *faceBounds;
+    uint                    *faceFlags;
+    short                   *faceSectors;
+
+    // sector adjacency. each sector reserves room in portals for
+    // every breakable wall that can be opened up during play
+    uint                    *portalStart;
+    uint                    *portalCount;
+    mapPortal_t             *portals;
+    uint                    *toggleStart;
+    int                     *toggleFaces;
+    uint                    *passageStart;
+    int                     *passageFaces;
+
     sectorList_t            scanSectors;
     kexSDNode<kexActor>     areaNodes;
+
+    kexSectorWalk           sectorWalks[MAX_SECTORWALKS];
+    int                     numActiveWalks;
 };
 
+//
+// kexSectorWalk::WalkPortals
+//
+// Hands every portal leading out of sector to edgeFunc and
+// marks or queues the neighbor based on what it returns
+//
+
+d_inline void kexSectorWalk::WalkPortals(mapSector_t *sector, walkEdgeFunc_t edgeFunc, void *data)
+{
+    const int secnum = sector - sectors;
+    const mapPortal_t *portal = world->SectorPortals(secnum);
+    const uint count = world->NumSectorPortals(secnum);
+
+    for(uint i = 0; i < count; ++i, ++portal)
+    {
+        mapSector_t *next = &sectors[portal->sector];
+
+        switch(edgeFunc(this, sector, next, portal, data))
+        {
+        case WALK_MARK:
+            Mark(next);
+            break;
+        case WALK_ENTER:
+            Enter(next);
+            break;
+        case WALK_STOP:
+            return;
+        default:
+            break;
+        }
+    }
+}
+
 #endif
@@ -49,6 +49,7 @@
 #endif // WIN32
 
 #include <stdio.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <stdarg.h>
 #include <string.h>
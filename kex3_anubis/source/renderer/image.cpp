@@ -106,8 +106,6 @@ typedef struct
 // ------------------------------------------------------
 //
 
-static byte *pngReadData;
-
 //
 // PNGRowSize
 //
@@ -130,8 +128,27 @@ d_inline static size_t PNGRowSize(int width, byte bits)
 
 static void PNGReadFunc(png_structp ctx, png_bytep area, png_size_t size)
 {
-    memcpy(area, pngReadData, size);
-    pngReadData += size;
+    const byte **input = static_cast<const byte**>(png_get_io_ptr(ctx));
+
+    memcpy(area, *input, size);
+    *input += size;
+}
+
+//
+// PNGWriteFunc
+//
+
+static void PNGWriteFunc(png_structp ctx, png_bytep area, png_size_t size)
+{
+    static_cast<kexBinFile*>(png_get_io_ptr(ctx))->WriteBytes(area, (unsigned int)size);
+}
+
+//
+// PNGFlushFunc
+//
+
+static void PNGFlushFunc(png_structp ctx)
+{
 }
 
 //
@@ -218,10 +235,26 @@ void kexImage::Alloc(void)
 void kexImage::LoadFromFile(const char *file)
 {
     byte *fileData;
+    kexImage *decoded;
 
     strcpy(filePath, file);
 
-    if(kex::cPakFiles->OpenFile(file, &fileData, hb_static) == 0)
+    // may have already been decoded on a file system worker thread
+    if((decoded = static_cast<kexImage*>(kex::cPakFiles->TakeDecoded(file))))
+    {
+        data        = decoded->data;
+        width       = decoded->width;
+        height      = decoded->height;
+        origwidth   = decoded->origwidth;
+        origheight  = decoded->origheight;
+        colorMode   = decoded->colorMode;
+
+        decoded->data = NULL;
+        delete decoded;
+        return;
+    }
+
+    if(kex::cPakFiles->OpenFileView(file, &fileData) == 0)
     {
         return;
     }
@@ -244,7 +277,42 @@ void kexImage::LoadFromFile(const char *file)
         kex::cSystem->Warning("kexImage::LoadFromFile(%s) - Unknown file format\n", file);
     }
 
-    Mem_Free(fileData);
+    kex::cPakFiles->CloseFileView(fileData);
+}
+
+//
+// kexImage::DecodeFile
+//
+// Registered with the file system so prefetched pngs get decoded on its
+// worker threads. Anything that might need to report an error is
+// left alone and loaded on the game thread as usual
+//
+
+void *kexImage::DecodeFile(const char *file, const byte *data, const unsigned int length)
+{
+    static const byte pngSignature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    kexImage *image;
+
+    if(length < 33 || memcmp(data, pngSignature, 8) || data[25] == PNG_COLOR_TYPE_PALETTE)
+    {
+        return NULL;
+    }
+
+    image = new kexImage;
+    strncpy(image->filePath, file, sizeof(filepath_t)-1);
+    image->filePath[sizeof(filepath_t)-1] = 0;
+    image->LoadFromPNG(data);
+
+    return image;
+}
+
+//
+// kexImage::FreeDecoded
+//
+
+void kexImage::FreeDecoded(void *image)
+{
+    delete static_cast<kexImage*>(image);
 }
 
 //
@@ -482,6 +550,7 @@ void kexImage::WriteTGA(kexBinFile &binFile)
 {
     tgaheader_t tga;
     int bits = colorMode == TCR_RGB ? 3 : 4;
+    byte *row;
 
     memset(&tga, 0, sizeof(tgaheader_t));
 
@@ -507,17 +576,29 @@ void kexImage::WriteTGA(kexBinFile &binFile)
     binFile.Write8(tga.pixel_bits);
     binFile.Write8(tga.flags);
 
-    for(int i = 0; i < (tga.width * tga.height); i++)
+    row = (byte*)Mem_Malloc(tga.width * bits, hb_static);
+
+    for(int y = 0; y < tga.height; y++)
     {
-        binFile.Write8(data[i * bits + 2]);
-        binFile.Write8(data[i * bits + 1]);
-        binFile.Write8(data[i * bits + 0]);
+        const byte *src = data + y * tga.width * bits;
 
-        if(colorMode == TCR_RGBA)
+        // swap to BGR(A) a row at a time
+        for(int x = 0; x < tga.width; x++)
         {
-            binFile.Write8(data[i * bits + 4]);
+            row[x * bits + 0] = src[x * bits + 2];
+            row[x * bits + 1] = src[x * bits + 1];
+            row[x * bits + 2] = src[x * bits + 0];
+
+            if(colorMode == TCR_RGBA)
+            {
+                row[x * bits + 3] = src[x * bits + 3];
+            }
         }
+
+        binFile.WriteBytes(row, tga.width * bits);
     }
+
+    Mem_Free(row);
 }
 
 //
@@ -657,7 +738,7 @@ void kexImage::LoadFromBMP(byte *input)
 // kexImage::LoadFromPNG
 //
 
-void kexImage::LoadFromPNG(byte *input)
+void kexImage::LoadFromPNG(const byte *input)
 {
     png_structp png_ptr;
     png_infop   info_ptr;
@@ -688,10 +769,8 @@ void kexImage::LoadFromPNG(byte *input)
         return;
     }
 
-    pngReadData = input;
-
     // setup callback function for reading data
-    png_set_read_fn(png_ptr, NULL, PNGReadFunc);
+    png_set_read_fn(png_ptr, &input, PNGReadFunc);
 
     // read png information
     png_read_info(png_ptr, info_ptr);
@@ -753,7 +832,8 @@ void kexImage::LoadFromPNG(byte *input)
 
     Alloc();
 
-    row_pointers = (byte**)Mem_AllocStatic(sizeof(byte*)*origheight);
+    // may be running on a worker thread, so stay off the heap
+    row_pointers = new byte*[origheight];
 
     for(row = 0; row < origheight; row++)
     {
@@ -763,7 +843,7 @@ void kexImage::LoadFromPNG(byte *input)
     png_read_image(png_ptr, row_pointers);
     png_read_end(png_ptr, info_ptr);
 
-    Mem_Free(row_pointers);
+    delete[] row_pointers;
     png_destroy_read_struct(&png_ptr, &info_ptr, NULL);
 }
 
@@ -794,7 +874,7 @@ void kexImage::WritePNG(kexBinFile &binFile)
         return;
     }
 
-    png_init_io(png_ptr, binFile.Handle());
+    png_set_write_fn(png_ptr, &binFile, PNGWriteFunc, PNGFlushFunc);
 
     // setup image
     png_set_IHDR(
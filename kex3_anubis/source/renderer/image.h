@@ -39,6 +39,9 @@ public:
     void                    WritePNG(kexBinFile &binFile);
     void                    Blit(kexImage &image, const int x, const int y);
 
+    static void             *DecodeFile(const char *file, const byte *data, const unsigned int length);
+    static void             FreeDecoded(void *image);
+
     const byte              *Data(void) const { return data; }
     const int               Width(void) const { return width; }
     const int               Height(void) const { return height; }
@@ -49,7 +52,7 @@ public:
 private:
     void                    LoadFromTGA(byte *input);
     void                    LoadFromBMP(byte *input);
-    void                    LoadFromPNG(byte *input);
+    void                    LoadFromPNG(const byte *input);
     byte                    GetRGBGamma(int c);
     void                    Alloc(void);
 
@@ -362,12 +362,16 @@ void kexRenderScene::SetFaceDistance(kexRenderView &view, mapFace_t *face)
 void kexRenderScene::FindVisibleSectors(kexRenderView &view, mapSector_t *sector)
 {
     static int clipCount = 0;
-    sectorList_t *scanSectors;
+    kexSectorWalk *walk;
+    mapSector_t *s;
+    kexPlane *facePlanes;
+    kexBBox *faceBounds;
+    uint *faceFlags;
+    short *faceSectors;
 
     int secnum;
     int start, end;
     kexVec3 origin;
-    uint scanCount;
     float w, h;
     
     if(bPrintStats)
@@ -382,50 +386,29 @@ void kexRenderScene::FindVisibleSectors(kexRenderView &view, mapSector_t *sector
     w = (float)kex::cSystem->VideoWidth();
     h = (float)kex::cSystem->VideoHeight();
 
-    for(uint i = 0; i < world->NumSectors(); ++i)
-    {
-        world->Sectors()[i].x1 = w;
-        world->Sectors()[i].x2 = 0;
-        world->Sectors()[i].y1 = h;
-        world->Sectors()[i].y2 = 0;
-
-        world->Sectors()[i].floodCount = 0;
-        world->Sectors()[i].flags &= ~SF_CLIPPED;
-    }
-
     origin = view.Origin();
 
-    scanSectors = &world->ScanSectors();
-
-    scanSectors->Reset();
-    scanSectors->Set(sector);
+    facePlanes = world->FacePlanes();
+    faceBounds = world->FaceBounds();
+    faceFlags = world->FaceFlags();
+    faceSectors = world->FaceSectors();
 
     visibleSkyFaces.Reset();
     visibleSectors.Reset();
     visibleSectors.Set(secnum);
 
-    world->ClearSectorPVS();
-    world->MarkSectorInPVS(secnum);
-
-    sector->floodCount = 1;
+    sector->flags &= ~SF_CLIPPED;
     sector->x1 = 0;
     sector->x2 = w;
     sector->y1 = 0;
     sector->y2 = h;
 
-    scanCount = 0;
+    // a sector's scissor rect is only reset the first time the walk reaches it
+    walk = world->AcquireWalk();
+    walk->Start(sector);
     
-    do
+    while((s = walk->Next()) != NULL)
     {
-        mapSector_t *s = (*scanSectors)[scanCount++];
-        
-        if(s->floodCount == 0)
-        {
-            continue;
-        }
-        
-        s->floodCount = 0;
-
         start = s->faceStart;
         end = s->faceEnd;
         
@@ -437,11 +420,9 @@ void kexRenderScene::FindVisibleSectors(kexRenderView &view, mapSector_t *sector
 
             for(int i = start; i < end+3; ++i)
             {
-                mapFace_t *face = &world->Faces()[i];
+                dist = facePlanes[i].Distance(origin);
 
-                dist = face->plane.Distance(origin);
-
-                if(face->flags & FF_PORTAL)
+                if(faceFlags[i] & FF_PORTAL)
                 {
                     if(i < end+1 && dist <= 0)
                     {
@@ -454,7 +435,9 @@ void kexRenderScene::FindVisibleSectors(kexRenderView &view, mapSector_t *sector
                 // * render view is not 'on' the plane
                 // * render view is 64 units away from a ceiling/floor portal
                 
-                if(face->flags & FF_WATER || dist <= 0.5f || (i >= end+1 && dist < 64))
+                mapFace_t *face = &world->Faces()[i];
+
+                if(faceFlags[i] & FF_WATER || dist <= 0.5f || (i >= end+1 && dist < 64))
                 {
                     face->x1 = 0;
                     face->x2 = w;
@@ -463,84 +446,116 @@ void kexRenderScene::FindVisibleSectors(kexRenderView &view, mapSector_t *sector
                 }
                 else
                 {
-                    SetScissorRect(view, &world->Faces()[i]);
+                    SetScissorRect(view, face);
                 }
             }
         }
         
         for(int i = start; i < end+3; ++i)
         {
-            mapFace_t *face = &world->Faces()[i];
+            mapFace_t *face;
 
-            if(i < end+1 && !view.TestBoundingBox(face->bounds))
+            if(faceSectors[i] >= 0 && faceFlags[i] & FF_PORTAL)
             {
+                // portals are walked below
                 continue;
             }
-            
-            if(face->sector >= 0 && face->flags & FF_PORTAL)
+
+            if(i < end+1 && !view.TestBoundingBox(faceBounds[i]))
             {
-                mapSector_t *next = &world->Sectors()[face->sector];
-                bool bInside = false;
+                continue;
+            }
 
-                if(next->bounds.max.z <= next->bounds.min.z)
-                {
-                    continue;
-                }
+            face = &world->Faces()[i];
+            face->flags |= FF_OCCLUDED;
 
-                if(face->x2 < s->x1) continue;
-                if(face->x1 > s->x2) continue;
-                if(face->y2 < s->y1) continue;
-                if(face->y1 > s->y2) continue;
+            if(face->x2 < s->x1) continue;
+            if(face->x1 > s->x2) continue;
+            if(face->y2 < s->y1) continue;
+            if(face->y1 > s->y2) continue;
 
-                float tx1 = face->x1;
-                float tx2 = face->x2;
-                float ty1 = face->y1;
-                float ty2 = face->y2;
-                
-                if(tx1 < s->x1) tx1 = s->x1;
-                if(tx2 > s->x2) tx2 = s->x2;
-                if(ty1 < s->y1) ty1 = s->y1;
-                if(ty2 > s->y2) ty2 = s->y2;
+            face->flags &= ~FF_OCCLUDED;
 
-                if(tx1 < next->x1) { next->x1 = tx1; bInside = true; }
-                if(tx2 > next->x2) { next->x2 = tx2; bInside = true; }
-                if(ty1 < next->y1) { next->y1 = ty1; bInside = true; }
-                if(ty2 > next->y2) { next->y2 = ty2; bInside = true; }
+            if((face->polyStart == -1 || face->polyEnd == -1))
+            {
+                visibleSkyFaces.Set(i);
+            }
+        }
 
-                if(!bInside)
-                {
-                    next->flags |= SF_CLIPPED;
-                    continue;
-                }
-                
-                if(!world->SectorInPVS(face->sector))
-                {
-                    world->MarkSectorInPVS(face->sector);
-                    visibleSectors.Set(face->sector);
-                }
+        const int snum = s - world->Sectors();
+        mapPortal_t *portal = world->SectorPortals(snum);
 
-                scanSectors->Set(next);
-                next->floodCount = 1;
+        for(uint p = 0; p < world->NumSectorPortals(snum); ++p, ++portal)
+        {
+            const int i = portal->face;
+            mapFace_t *face;
+
+            if(!world->SectorPotentiallyVisible(secnum, portal->sector))
+            {
+                continue;
             }
-            else
+
+            if(i < end+1 && !view.TestBoundingBox(faceBounds[i]))
             {
-                face->flags |= FF_OCCLUDED;
+                continue;
+            }
 
-                if(face->x2 < s->x1) continue;
-                if(face->x1 > s->x2) continue;
-                if(face->y2 < s->y1) continue;
-                if(face->y1 > s->y2) continue;
+            face = &world->Faces()[i];
+            mapSector_t *next = &world->Sectors()[portal->sector];
+            bool bInside = false;
 
-                face->flags &= ~FF_OCCLUDED;
+            if(!walk->IsMarked(next))
+            {
+                walk->Mark(next);
 
-                if((face->polyStart == -1 || face->polyEnd == -1))
-                {
-                    visibleSkyFaces.Set(i);
-                }
+                next->x1 = w;
+                next->x2 = 0;
+                next->y1 = h;
+                next->y2 = 0;
+                next->flags &= ~SF_CLIPPED;
+            }
+
+            if(next->bounds.max.z <= next->bounds.min.z)
+            {
+                continue;
             }
+
+            if(face->x2 < s->x1) continue;
+            if(face->x1 > s->x2) continue;
+            if(face->y2 < s->y1) continue;
+            if(face->y1 > s->y2) continue;
+
+            float tx1 = face->x1;
+            float tx2 = face->x2;
+            float ty1 = face->y1;
+            float ty2 = face->y2;
+            
+            if(tx1 < s->x1) tx1 = s->x1;
+            if(tx2 > s->x2) tx2 = s->x2;
+            if(ty1 < s->y1) ty1 = s->y1;
+            if(ty2 > s->y2) ty2 = s->y2;
+
+            if(tx1 < next->x1) { next->x1 = tx1; bInside = true; }
+            if(tx2 > next->x2) { next->x2 = tx2; bInside = true; }
+            if(ty1 < next->y1) { next->y1 = ty1; bInside = true; }
+            if(ty2 > next->y2) { next->y2 = ty2; bInside = true; }
+
+            if(!bInside)
+            {
+                next->flags |= SF_CLIPPED;
+                continue;
+            }
+            
+            if(!walk->WasEntered(next))
+            {
+                visibleSectors.Set(portal->sector);
+            }
+
+            walk->Enter(next);
         }
-        
-    } while(scanCount < scanSectors->CurrentLength());
+    }
+    
+    world->ReleaseWalk(walk);
     
     if(bPrintStats)
     {
@@ -26,6 +26,21 @@ kexCvar kexRenderScene::cvarRenderFixSpriteClipping("r_fixspriteclipping", CVF_B
 
 bufferUpdateList_t kexRenderScene::bufferUpdateList;
 
+// bump whenever BuildSectorBuffer changes what it produces
+#define BUFFERCACHE_VERSION     1
+
+enum
+{
+    BCL_VERTICES    = 0,
+    BCL_INDICES,
+    BCL_PORTALBUFFERS,
+    BCL_SECTORSTART,
+    BCL_SECTORBUFFERS,
+    BCL_LOOKUPSTART,
+    BCL_LOOKUP,
+    NUMBUFFERCACHELUMPS
+};
+
 #define RENDERSCENE_DEFINE_DEBUG_COMMAND(var, cmd)  \
     bool kexRenderScene:: var = false;  \
     COMMAND(cmd)    \
@@ -90,6 +105,8 @@ void kexRenderScene::InitVertexBuffer(void)
     // extra padding to the total number of vertices in the level
     worldVertexBuffer.Allocate(NULL, world->NumVertices()*3, kexVertBuffer::RBU_DYNAMIC,
                                NULL, world->NumPolys()*8, kexVertBuffer::RBU_DYNAMIC);
+
+    BuildWorldBuffer();
 }
 
 //
@@ -602,6 +619,358 @@ void kexRenderScene::BuildSectorBuffer(mapSector_t *sector)
     } while(++scanTexturesIdx < sector->bufferIndex.Length());
 }
 
+//
+// kexRenderScene::BuildWorldBuffer
+//
+// Builds the buffers for every sector up front instead of the first
+// time each one is drawn, so the result can be cached next to the map
+// and just copied in on later loads
+//
+
+void kexRenderScene::BuildWorldBuffer(void)
+{
+    kexBinFile cacheFile;
+    const kexVertBuffer::drawVert_t *verts;
+    const uint *indices;
+    kexVertBuffer::drawVert_t *buildVerts = NULL;
+    uint *buildIndices = NULL;
+    uint64_t startTime = kex::cTimer->GetPerformanceCounter();
+    bool bCached;
+
+    if(!(bCached = LoadBufferCache(cacheFile, &verts, &indices)))
+    {
+        buildVerts = (kexVertBuffer::drawVert_t*)Mem_Calloc(sizeof(kexVertBuffer::drawVert_t) *
+                                                            world->NumVertices()*3, kexWorld::hb_world);
+        buildIndices = (uint*)Mem_Calloc(sizeof(uint) * world->NumPolys()*8, kexWorld::hb_world);
+
+        drawVerts = buildVerts;
+        drawIndices = buildIndices;
+
+        for(uint i = 0; i < world->NumSectors(); ++i)
+        {
+            mapSector_t *sector = &world->Sectors()[i];
+
+            BuildSectorBuffer(sector);
+            sector->flags |= SF_PROCESSED;
+        }
+
+        SaveBufferCache(buildVerts, buildIndices);
+
+        verts = buildVerts;
+        indices = buildIndices;
+    }
+
+    worldVertexBuffer.Bind();
+
+    drawVerts = worldVertexBuffer.MapVertexBuffer();
+    drawIndices = worldVertexBuffer.MapIndiceBuffer();
+
+    if(drawVerts != NULL && drawIndices != NULL)
+    {
+        for(uint i = 0; i < vertexCount; ++i)
+        {
+            drawVerts[i] = verts[i];
+        }
+
+        memcpy(drawIndices, indices, sizeof(uint) * indiceCount);
+    }
+
+    worldVertexBuffer.UnMapVertexBuffer();
+    worldVertexBuffer.UnMapIndiceBuffer();
+    worldVertexBuffer.UnBind();
+
+    drawVerts = NULL;
+    drawIndices = NULL;
+
+    if(buildVerts)
+    {
+        Mem_Free(buildVerts);
+        Mem_Free(buildIndices);
+    }
+
+    kex::cSystem->DPrintf("World buffers %s in %fms\n", bCached ? "loaded" : "built",
+                          kex::cTimer->MeasurePerformance(startTime));
+}
+
+//
+// kexRenderScene::BufferIndexInRange
+//
+// Checks a cached buffer against the vertex and index
+// counts stored with it. triStart is a byte offset
+//
+
+bool kexRenderScene::BufferIndexInRange(const bufferIndex_t *buffer, const uint numVerts,
+                                        const uint numIndices)
+{
+    if( buffer->triStart < 0 || buffer->vertStart < 0 || buffer->count < 0 ||
+        buffer->numVert < 0 || buffer->numTris < 0)
+    {
+        return false;
+    }
+
+    if((buffer->triStart % sizeof(uint)) != 0)
+    {
+        return false;
+    }
+
+    if((uint)buffer->triStart / sizeof(uint) + (uint)buffer->count > numIndices)
+    {
+        return false;
+    }
+
+    if((uint)buffer->vertStart + (uint)buffer->numVert > numVerts)
+    {
+        return false;
+    }
+
+    return true;
+}
+
+//
+// kexRenderScene::LoadBufferCache
+//
+// Any entry that doesn't fit the cached buffers rejects the
+// whole cache so it gets rebuilt
+//
+
+bool kexRenderScene::LoadBufferCache(kexBinFile &file, const kexVertBuffer::drawVert_t **verts,
+                                     const uint **indices)
+{
+    const mapCacheHeader_t *header;
+    const bufferIndex_t *portalBuffers;
+    const bufferIndex_t *sectorBuffers;
+    const int *sectorStart;
+    const int *lookupStart;
+    const int *lookup;
+    uint numSectors = world->NumSectors();
+    uint numVertices = world->NumVertices();
+    uint numVerts;
+    uint numIndices;
+
+    if(!world->OpenMapCache(file, ".kmb", BUFFERCACHE_VERSION, NUMBUFFERCACHELUMPS))
+    {
+        return false;
+    }
+
+    header = (const mapCacheHeader_t*)file.Buffer();
+
+    numVerts = header->lumps[BCL_VERTICES].length / sizeof(kexVertBuffer::drawVert_t);
+    numIndices = header->lumps[BCL_INDICES].length / sizeof(uint);
+
+    if(numVerts > numVertices*3 || numIndices > world->NumPolys()*8)
+    {
+        return false;
+    }
+
+    *verts = (const kexVertBuffer::drawVert_t*)kexWorld::MapCacheLump(file, BCL_VERTICES,
+                                                                      sizeof(kexVertBuffer::drawVert_t), numVerts);
+    *indices = (const uint*)kexWorld::MapCacheLump(file, BCL_INDICES, sizeof(uint), numIndices);
+
+    portalBuffers = (const bufferIndex_t*)kexWorld::MapCacheLump(file, BCL_PORTALBUFFERS,
+                                                                 sizeof(bufferIndex_t), numSectors);
+    sectorStart = (const int*)kexWorld::MapCacheLump(file, BCL_SECTORSTART, sizeof(int), numSectors+1);
+    lookupStart = (const int*)kexWorld::MapCacheLump(file, BCL_LOOKUPSTART, sizeof(int), numVertices+1);
+
+    if(!*verts || !*indices || !portalBuffers || !sectorStart || !lookupStart)
+    {
+        return false;
+    }
+
+    sectorBuffers = (const bufferIndex_t*)kexWorld::MapCacheLump(file, BCL_SECTORBUFFERS, sizeof(bufferIndex_t),
+                                                                 sectorStart[numSectors]);
+    lookup = (const int*)kexWorld::MapCacheLump(file, BCL_LOOKUP, sizeof(int), lookupStart[numVertices]);
+
+    if(!sectorBuffers || !lookup)
+    {
+        return false;
+    }
+
+    // make sure the offsets are sane before touching anything
+    for(uint i = 0; i < numSectors; ++i)
+    {
+        if(sectorStart[i] < 0 || sectorStart[i] > sectorStart[i+1])
+        {
+            return false;
+        }
+    }
+
+    for(uint i = 0; i < numVertices; ++i)
+    {
+        if(lookupStart[i] < 0 || lookupStart[i] > lookupStart[i+1])
+        {
+            return false;
+        }
+    }
+
+    for(uint i = 0; i < numSectors; ++i)
+    {
+        if(!BufferIndexInRange(&portalBuffers[i], numVerts, numIndices))
+        {
+            return false;
+        }
+    }
+
+    for(uint i = 0; i < numSectors; ++i)
+    {
+        for(int j = sectorStart[i]; j < sectorStart[i+1]; ++j)
+        {
+            const bufferIndex_t *buffer = &sectorBuffers[j];
+
+            if(!BufferIndexInRange(buffer, numVerts, numIndices) || buffer->sector != (int)i)
+            {
+                return false;
+            }
+
+            if(buffer->texture < 0 || (uint)buffer->texture >= world->NumTextures())
+            {
+                return false;
+            }
+        }
+    }
+
+    for(int i = 0; i < lookupStart[numVertices]; ++i)
+    {
+        if(lookup[i] < 0 || (uint)lookup[i] >= numVerts)
+        {
+            return false;
+        }
+    }
+
+    for(uint i = 0; i < numIndices; ++i)
+    {
+        if((*indices)[i] >= numVerts)
+        {
+            return false;
+        }
+    }
+
+    for(uint i = 0; i < numSectors; ++i)
+    {
+        mapSector_t *sector = &world->Sectors()[i];
+        uint count = sectorStart[i+1] - sectorStart[i];
+
+        sector->portalBuffer = portalBuffers[i];
+        sector->bufferIndex.Resize(count);
+
+        for(uint j = 0; j < count; ++j)
+        {
+            sector->bufferIndex[j] = sectorBuffers[sectorStart[i] + j];
+        }
+
+        sector->flags |= SF_PROCESSED;
+    }
+
+    for(uint i = 0; i < numVertices; ++i)
+    {
+        uint count = lookupStart[i+1] - lookupStart[i];
+
+        vertexBufferLookup[i].Resize(count);
+
+        for(uint j = 0; j < count; ++j)
+        {
+            vertexBufferLookup[i][j] = lookup[lookupStart[i] + j];
+        }
+    }
+
+    vertexCount = numVerts;
+    indiceCount = numIndices;
+    drawTris = numVerts;
+
+    return true;
+}
+
+//
+// kexRenderScene::SaveBufferCache
+//
+
+void kexRenderScene::SaveBufferCache(const kexVertBuffer::drawVert_t *verts, const uint *indices)
+{
+    const void *lumpData[NUMBUFFERCACHELUMPS];
+    uint lumpSizes[NUMBUFFERCACHELUMPS];
+    uint numSectors = world->NumSectors();
+    uint numVertices = world->NumVertices();
+    bufferIndex_t *portalBuffers;
+    bufferIndex_t *sectorBuffers;
+    int *sectorStart;
+    int *lookupStart;
+    int *lookup;
+    uint count;
+
+    if(!kexWorld::cvarMapCache.GetBool())
+    {
+        return;
+    }
+
+    portalBuffers = (bufferIndex_t*)Mem_Malloc(sizeof(bufferIndex_t) * numSectors, kexWorld::hb_world);
+    sectorStart = (int*)Mem_Malloc(sizeof(int) * (numSectors+1), kexWorld::hb_world);
+    lookupStart = (int*)Mem_Malloc(sizeof(int) * (numVertices+1), kexWorld::hb_world);
+
+    count = 0;
+
+    for(uint i = 0; i < numSectors; ++i)
+    {
+        portalBuffers[i] = world->Sectors()[i].portalBuffer;
+        sectorStart[i] = count;
+        count += world->Sectors()[i].bufferIndex.Length();
+    }
+
+    sectorStart[numSectors] = count;
+    sectorBuffers = (bufferIndex_t*)Mem_Malloc(sizeof(bufferIndex_t) * (count+1), kexWorld::hb_world);
+
+    for(uint i = 0; i < numSectors; ++i)
+    {
+        mapSector_t *sector = &world->Sectors()[i];
+
+        for(uint j = 0; j < sector->bufferIndex.Length(); ++j)
+        {
+            sectorBuffers[sectorStart[i] + j] = sector->bufferIndex[j];
+        }
+    }
+
+    count = 0;
+
+    for(uint i = 0; i < numVertices; ++i)
+    {
+        lookupStart[i] = count;
+        count += vertexBufferLookup[i].Length();
+    }
+
+    lookupStart[numVertices] = count;
+    lookup = (int*)Mem_Malloc(sizeof(int) * (count+1), kexWorld::hb_world);
+
+    for(uint i = 0; i < numVertices; ++i)
+    {
+        for(uint j = 0; j < vertexBufferLookup[i].Length(); ++j)
+        {
+            lookup[lookupStart[i] + j] = vertexBufferLookup[i][j];
+        }
+    }
+
+    lumpData[BCL_VERTICES]          = verts;
+    lumpData[BCL_INDICES]           = indices;
+    lumpData[BCL_PORTALBUFFERS]     = portalBuffers;
+    lumpData[BCL_SECTORSTART]       = sectorStart;
+    lumpData[BCL_SECTORBUFFERS]     = sectorBuffers;
+    lumpData[BCL_LOOKUPSTART]       = lookupStart;
+    lumpData[BCL_LOOKUP]            = lookup;
+
+    lumpSizes[BCL_VERTICES]         = sizeof(kexVertBuffer::drawVert_t) * vertexCount;
+    lumpSizes[BCL_INDICES]          = sizeof(uint) * indiceCount;
+    lumpSizes[BCL_PORTALBUFFERS]    = sizeof(bufferIndex_t) * numSectors;
+    lumpSizes[BCL_SECTORSTART]      = sizeof(int) * (numSectors+1);
+    lumpSizes[BCL_SECTORBUFFERS]    = sizeof(bufferIndex_t) * sectorStart[numSectors];
+    lumpSizes[BCL_LOOKUPSTART]      = sizeof(int) * (numVertices+1);
+    lumpSizes[BCL_LOOKUP]           = sizeof(int) * lookupStart[numVertices];
+
+    world->WriteMapCache(".kmb", BUFFERCACHE_VERSION, lumpData, lumpSizes, NUMBUFFERCACHELUMPS);
+
+    Mem_Free(portalBuffers);
+    Mem_Free(sectorStart);
+    Mem_Free(sectorBuffers);
+    Mem_Free(lookupStart);
+    Mem_Free(lookup);
+}
+
 //
 // kexRenderScene::UpdateBuffer
 //
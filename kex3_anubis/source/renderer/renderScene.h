@@ -119,6 +119,12 @@ private:
     void                            ShadeWaterColor(kexVec3 &origin, int &r, int &g, int &b);
     void                            PrintStats(void);
     void                            BuildSectorBuffer(mapSector_t *sector);
+    void                            BuildWorldBuffer(void);
+    bool                            BufferIndexInRange(const bufferIndex_t *buffer, const uint numVerts,
+                                                       const uint numIndices);
+    bool                            LoadBufferCache(kexBinFile &file, const kexVertBuffer::drawVert_t **verts,
+                                                    const uint **indices);
+    void                            SaveBufferCache(const kexVertBuffer::drawVert_t *verts, const uint *indices);
     void                            UpdateBuffer(void);
     void                            FindVisibleSectors(kexRenderView &view, mapSector_t *sector);
     bool                            SetScissorRect(kexRenderView &view, mapFace_t *face);
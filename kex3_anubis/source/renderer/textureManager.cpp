@@ -134,6 +134,9 @@ void kexTextureManager::Init(void)
     CreateWhiteTexture();
     CreateDefaultTexture();
     CreateLightTexture();
+
+    // let prefetched textures get decoded off the game thread
+    kex::cPakFiles->AddDecoder(".png", kexImage::DecodeFile, kexImage::FreeDecoded);
 }
 
 //
@@ -142,14 +145,14 @@ void kexTextureManager::Init(void)
 
 void kexTextureManager::Shutdown(void)
 {
-    for(int i = 0; i < MAX_HASH; i++)
+    for(int i = 0; i < textureList.Length(); i++)
     {
-        for(kexTexture *texture = textureList.GetData(i); texture; texture = textureList.Next())
-        {
-            texture->Delete();
-        }
+        kexTexture *texture = textureList.GetData(i);
+        texture->Delete();
     }
 
+    atomLookup.Empty();
+
     // do last round of texture flushing to make sure we freed everything
     Mem_Purge(kexTexture::hb_texture);
 }
@@ -176,3 +179,40 @@ kexTexture *kexTextureManager::Cache(const char *name, texClampMode_t clampMode,
 
     return texture;
 }
+
+//
+// kexTextureManager::Cache
+//
+// Resolves the texture once per atom and caches it
+//
+
+kexTexture *kexTextureManager::Cache(const kexAtom &name, texClampMode_t clampMode,
+                                     texFilterMode_t filterMode)
+{
+    kexTexture *texture;
+
+    if(name.ID() < (int)atomLookup.Length() && (texture = atomLookup[name.ID()]))
+    {
+        return texture;
+    }
+
+    if(!(texture = Cache(name.c_str(), clampMode, filterMode)))
+    {
+        return NULL;
+    }
+
+    if(name.ID() >= (int)atomLookup.Length())
+    {
+        unsigned int start = atomLookup.Length();
+
+        atomLookup.Resize(kexAtom::NumAtoms());
+
+        for(unsigned int i = start; i < atomLookup.Length(); ++i)
+        {
+            atomLookup[i] = NULL;
+        }
+    }
+
+    atomLookup[name.ID()] = texture;
+    return texture;
+}
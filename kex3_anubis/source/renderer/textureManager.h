@@ -26,6 +26,9 @@ public:
 
     kexTexture              *Cache(const char *name, texClampMode_t clampMode,
                                    texFilterMode_t filterMode);
+    kexTexture              *Cache(const kexAtom &name, texClampMode_t clampMode,
+                                   texFilterMode_t filterMode);
+    bool                    IsCached(const char *name) { return textureList.Find(name) != NULL; }
 
     kexTexture              *defaultTexture;
     kexTexture              *whiteTexture;
@@ -37,6 +40,7 @@ private:
     void                    CreateLightTexture(void);
 
     kexHashList<kexTexture> textureList;
+    kexArray<kexTexture*>   atomLookup;
 };
 
 #endif
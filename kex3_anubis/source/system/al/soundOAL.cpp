@@ -155,6 +155,8 @@ public:
     virtual bool                    SourceLooping(const int handle);
     virtual void                    Play(void *data, const int volume, const int sep,
                                          kexObject *ref = NULL, bool bLooping = false);
+    virtual void                    Play(const kexAtom &sound, const int volume, const int sep,
+                                         kexObject *ref = NULL, bool bLooping = false);
     virtual void                    Stop(const int handle);
     virtual void                    PlayMusic(const char *name, const bool bLoop = true);
     virtual void                    StopMusic(void);
@@ -162,6 +164,7 @@ public:
     virtual void                    Update(void);
     virtual const int               NumSources(void) const;
     virtual kexObject               *GetRefObject(const int handle);
+    virtual bool                    IsCached(const char *name);
 
     char                            *GetDeviceName(void);
     const int                       GetNumActiveSources(void) const { return activeSources; }
@@ -180,11 +183,15 @@ private:
     static bool                     bMusicActive;
 
     kexSoundSource                  *GetAvailableSource(void);
+    kexWavFile                      *CacheWave(const char *name);
+    void                            PlayWave(kexWavFile *wavFile, const int volume, const int sep,
+                                             kexObject *ref, bool bLooping);
 
     ALCdevice                       *alDevice;
     ALCcontext                      *alContext;
     kexSoundSource                  *sources;
     kexHashList<kexWavFile>         wavList;
+    kexArray<kexWavFile*>           wavAtoms;
     bool                            *sourcesActive;
     int                             activeSources;
 };
@@ -357,6 +364,9 @@ void kexWavFile::Delete(void)
 {
     alDeleteBuffers(1, &buffer);
     buffer = 0;
+
+    kex::cPakFiles->CloseFileView(waveFile);
+    waveFile = NULL;
 }
 
 //-----------------------------------------------------------------------------
@@ -902,14 +912,14 @@ void kexSoundOAL::Shutdown(void)
         sources[i].Delete();
     }
 
-    for(i = 0; i < MAX_HASH; i++)
+    for(i = 0; i < wavList.Length(); i++)
     {
-        for(wavFile = wavList.GetData(i); wavFile; wavFile = wavList.Next())
-        {
-            wavFile->Delete();
-        }
+        wavFile = wavList.GetData(i);
+        wavFile->Delete();
     }
 
+    wavAtoms.Empty();
+
     alcMakeContextCurrent(NULL);
     alcDestroyContext(alContext);
     alcCloseDevice(alDevice);
@@ -954,39 +964,109 @@ kexSoundSource *kexSoundOAL::GetAvailableSource(void)
     return src;
 }
 
+//
+// kexSoundOAL::CacheWave
+//
+
+kexWavFile *kexSoundOAL::CacheWave(const char *name)
+{
+    kexWavFile *wavFile;
+
+    if(!(wavFile = wavList.Find(name)))
+    {
+        byte *wavdata;
+
+        if(kex::cPakFiles->OpenFileView(name, &wavdata) == 0)
+        {
+            return NULL;
+        }
+
+        wavFile = wavList.Add(name, kexSoundOAL::hb_sound);
+        wavFile->Allocate(name, wavdata);
+    }
+
+    return wavFile;
+}
+
 //
 // kexSoundOAL::Play
 //
 
 void kexSoundOAL::Play(void *data, const int volume, const int sep, kexObject *ref, bool bLooping)
 {
-    kexSoundSource *src;
-    kexWavFile *wavFile = NULL;
-    char *name;
+    kexWavFile *wavFile;
 
     if(!bInitialized)
     {
         return;
     }
 
-    if(!(src = GetAvailableSource()))
+    if(!(wavFile = CacheWave((char*)data)))
     {
         return;
     }
 
-    name = (char*)data;
+    PlayWave(wavFile, volume, sep, ref, bLooping);
+}
 
-    if(!(wavFile = wavList.Find(name)))
+//
+// kexSoundOAL::Play
+//
+// Same as above but skips the name lookup once the
+// atom has been resolved to a wave
+//
+
+void kexSoundOAL::Play(const kexAtom &sound, const int volume, const int sep, kexObject *ref, bool bLooping)
+{
+    kexWavFile *wavFile = NULL;
+    const unsigned int id = (unsigned int)sound.ID();
+
+    if(!bInitialized)
     {
-        byte *wavdata;
+        return;
+    }
 
-        if(kex::cPakFiles->OpenFile(name, &wavdata, kexSoundOAL::hb_sound) == 0)
+    if(id < wavAtoms.Length())
+    {
+        wavFile = wavAtoms[id];
+    }
+
+    if(wavFile == NULL)
+    {
+        if(!(wavFile = CacheWave(sound.c_str())))
         {
             return;
         }
 
-        wavFile = wavList.Add(name, kexSoundOAL::hb_sound);
-        wavFile->Allocate(name, wavdata);
+        if(id >= wavAtoms.Length())
+        {
+            unsigned int start = wavAtoms.Length();
+
+            wavAtoms.Resize(kexAtom::NumAtoms());
+
+            for(unsigned int i = start; i < wavAtoms.Length(); ++i)
+            {
+                wavAtoms[i] = NULL;
+            }
+        }
+
+        wavAtoms[id] = wavFile;
+    }
+
+    PlayWave(wavFile, volume, sep, ref, bLooping);
+}
+
+//
+// kexSoundOAL::PlayWave
+//
+
+void kexSoundOAL::PlayWave(kexWavFile *wavFile, const int volume, const int sep, kexObject *ref, bool bLooping)
+{
+    kexSoundSource *src;
+
+    if(!(src = GetAvailableSource()))
+    {
+        return;
     }
 
     src->wave = wavFile;
@@ -1202,3 +1282,12 @@ kexObject *kexSoundOAL::GetRefObject(const int handle)
 
     return sources[handle].refObject;
 }
+
+//
+// kexSoundOAL::IsCached
+//
+
+bool kexSoundOAL::IsCached(const char *name)
+{
+    return wavList.Find(name) != NULL;
+}
@@ -136,6 +136,7 @@ void kexSystemSDL::Shutdown(void)
     kex::cPakFiles->Shutdown();
     kex::cCvars->Shutdown();
     kex::cInput->Shutdown();
+    kexObject::Shutdown();
     
     Mem_Purge(hb_static);
     Mem_Purge(hb_object);
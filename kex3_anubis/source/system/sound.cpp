@@ -82,6 +82,15 @@ void kexSound::Play(void *data, const int volume, const int sep, kexObject *ref,
 {
 }
 
+//
+// kexSound::Play
+//
+
+void kexSound::Play(const kexAtom &sound, const int volume, const int sep, kexObject *ref, bool bLooping)
+{
+    Play((void*)sound.c_str(), volume, sep, ref, bLooping);
+}
+
 //
 // kexSound::Stop
 //
@@ -141,3 +150,12 @@ kexObject *kexSound::GetRefObject(const int handle)
 {
     return NULL;
 }
+
+//
+// kexSound::IsCached
+//
+
+bool kexSound::IsCached(const char *name)
+{
+    return false;
+}
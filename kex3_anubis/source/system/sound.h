@@ -26,11 +26,14 @@ public:
     virtual void            UpdateSource(const int handle, const int volume, const int sep);
     virtual void            Play(void *data, const int volume, const int sep,
                                  kexObject *ref = NULL, bool bLooping = false);
+    virtual void            Play(const kexAtom &sound, const int volume, const int sep,
+                                 kexObject *ref = NULL, bool bLooping = false);
     virtual void            Stop(const int handle);
     virtual bool            Playing(const int handle);
     virtual bool            SourceLooping(const int handle);
     virtual const int       NumSources(void) const;
     virtual kexObject       *GetRefObject(const int handle);
+    virtual bool            IsCached(const char *name);
     virtual void            PlayMusic(const char *name, const bool bLoop = true);
     virtual void            StopMusic(void);
 
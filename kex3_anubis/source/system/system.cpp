@@ -154,13 +154,13 @@ void kexSystem::WriteConfigFile(void)
     kexStr str(kexStr::Format("%s\\config.cfg", kex::cvarBasePath.GetValue()));
     str.NormalizeSlashes();
     
-    FILE *f = fopen(str.c_str(), "w");
+    kexBinFile file;
     
-    if(f)
+    if(file.Create(str.c_str()))
     {
-        kex::cActions->WriteBindings(f);
-        kex::cCvars->WriteToFile(f);
-        fclose(f);
+        kex::cActions->WriteBindings(file);
+        kex::cCvars->WriteToFile(file);
+        file.Close();
     }
 }
 